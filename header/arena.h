@@ -0,0 +1,122 @@
+/*
+Arena Allocation
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+// An arena hands out memory by bumping a pointer through a big block, and frees everything at once when it's destroyed.
+// That makes allocating almost free, and since one thread owns one arena, threads never wait on each other inside malloc.
+// The catch: memory is only given back when the whole arena goes away, so nothing allocated from it may outlive it.
+
+class Arena
+{
+public:
+    explicit Arena(std::size_t blockSize = 1 << 20) : blockSize(blockSize) {}
+
+    ~Arena()
+    {
+        for (void* block : blocks)
+        {
+            std::free(block);
+        }
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment)
+    {
+        std::size_t start = alignedOffset(alignment);
+        if (current == nullptr || start + bytes > capacity)
+        {
+            grow(bytes + alignment);
+            start = alignedOffset(alignment);
+        }
+        used = start + bytes;
+        return current + start;
+    }
+
+    std::size_t bytesReserved() const { return reserved; }
+
+private:
+    std::size_t blockSize;
+    std::vector<void*> blocks;
+    char* current = nullptr;
+    std::size_t used = 0;
+    std::size_t capacity = 0;
+    std::size_t reserved = 0;
+
+    // Where the next allocation would start, rounded up so the address is a multiple of `alignment`.
+    std::size_t alignedOffset(std::size_t alignment) const
+    {
+        std::uintptr_t next = reinterpret_cast<std::uintptr_t>(current) + used;
+        return used + ((alignment - next % alignment) % alignment);
+    }
+
+    void grow(std::size_t atLeast)
+    {
+        std::size_t size = atLeast > blockSize ? atLeast : blockSize;
+        void* block = std::malloc(size);
+        if (block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        blocks.push_back(block);
+        current = static_cast<char*>(block);
+        used = 0;
+        capacity = size;
+        reserved += size;
+    }
+};
+
+
+// A standard allocator on top of an arena, so it works with std::allocate_shared, std::vector and friends.
+// deallocate does nothing, the arena frees everything at the end.
+template<class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, std::size_t) {}
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template<class U>
+    friend class ArenaAllocator;
+
+    Arena* arena;
+};
@@ -0,0 +1,114 @@
+/*
+Batch Weak Lock
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <xmmintrin.h>
+#endif
+
+// weakPtr.lock() has to look at the reference count, which lives in the control block somewhere else in memory.
+// Lock a few hundred weak_ptrs in a row and most of the time goes to waiting for those control blocks to arrive from RAM,
+// one at a time.
+//
+// lockBatch locks a whole array of them, but asks the CPU to start fetching the control block a few entries AHEAD
+// of the one it's locking (a "prefetch"). By the time we get there it's already in the cache.
+// The live ones come back packed together in a vector, and optionally where each one came from:
+//
+//     std::vector<std::shared_ptr<Person>> live;
+//     lockBatch(weakPeople.data(), weakPeople.size(), live);
+//
+// To find the control block we peek at the weak_ptr's second pointer. That's where libstdc++, libc++ and MSVC all keep it,
+// but it isn't promised anywhere. That's okay here: a prefetch is only a hint, a prefetch of a wrong address just does nothing.
+// The locking itself is plain lock(), each one is still its own atomic compare-and-swap.
+
+namespace batch_lock_detail
+{
+    const std::size_t PrefetchDistance = 8;    // How many entries ahead to fetch. Far enough to hide a trip to RAM, close enough to still be in cache.
+
+    template<class T>
+    const void* controlBlockOf(const std::weak_ptr<T>& weak)
+    {
+        static_assert(sizeof(std::weak_ptr<T>) == 2 * sizeof(void*), "expected a weak_ptr to be an object pointer and a control block pointer");
+        const void* words[2];
+        std::memcpy(words, &weak, sizeof(words));
+        return words[1];
+    }
+
+    inline void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 1);     // 1: we're going to write to it (the count).
+#elif defined(_MSC_VER)
+        _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+        (void)address;
+#endif
+    }
+}
+
+
+// Locks refs[0..count), appends the live ones to `live` (and their positions to `indices`, if given).
+// Returns how many were alive.
+template<class T>
+std::size_t lockBatch(const std::weak_ptr<T>* refs, std::size_t count, std::vector<std::shared_ptr<T>>& live, std::vector<std::size_t>* indices = nullptr)
+{
+    using namespace batch_lock_detail;
+
+    live.reserve(live.size() + count);
+    if (indices != nullptr)
+    {
+        indices->reserve(indices->size() + count);
+    }
+
+    for (std::size_t i = 0; i < count && i < PrefetchDistance; i++)
+    {
+        prefetch(controlBlockOf(refs[i]));
+    }
+
+    std::size_t found = 0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (i + PrefetchDistance < count)
+        {
+            prefetch(controlBlockOf(refs[i + PrefetchDistance]));
+        }
+
+        std::shared_ptr<T> strong = refs[i].lock();
+        if (strong != nullptr)
+        {
+            live.push_back(std::move(strong));
+            if (indices != nullptr)
+            {
+                indices->push_back(i);
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+
+template<class T>
+std::size_t lockBatch(const std::vector<std::weak_ptr<T>>& refs, std::vector<std::shared_ptr<T>>& live, std::vector<std::size_t>* indices = nullptr)
+{
+    return lockBatch(refs.data(), refs.size(), live, indices);
+}
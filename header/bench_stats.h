@@ -0,0 +1,134 @@
+/*
+Benchmark Statistics
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Running a benchmark once tells you very little. The machine is doing other things, caches are warm or cold...
+// So we run each scenario several times and summarize with statistics that don't care about a few crazy outliers:
+//
+//   median: the middle run. One slow run can't drag it around like it would an average.
+//   MAD:    median absolute deviation, the median distance from the median. Think "standard deviation, but robust".
+//   CI:     a 95% confidence interval for the median, found by bootstrapping (resampling our runs thousands of times).
+
+struct BenchSummary
+{
+    std::size_t runs = 0;
+    double median = 0;
+    double mad = 0;
+    double low = 0;     // 95% confidence interval of the median.
+    double high = 0;
+};
+
+
+inline double medianOf(std::vector<double> values)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    std::size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+
+inline BenchSummary summarize(const std::vector<double>& samples, int resamples = 2000)
+{
+    BenchSummary summary;
+    summary.runs = samples.size();
+    if (samples.empty())
+    {
+        return summary;
+    }
+
+    summary.median = medianOf(samples);
+
+    std::vector<double> deviations;
+    for (double sample : samples)
+    {
+        deviations.push_back(sample > summary.median ? sample - summary.median : summary.median - sample);
+    }
+    summary.mad = medianOf(deviations);
+
+    // Bootstrap: build fake runs by picking from our real runs at random (with repeats), and see how much their medians move.
+    // The RNG is seeded the same every time so the same samples always give the same interval.
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
+    std::vector<double> medians;
+    std::vector<double> resample(samples.size());
+    for (int r = 0; r < resamples; r++)
+    {
+        for (double& value : resample)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            value = samples[state % samples.size()];
+        }
+        medians.push_back(medianOf(resample));
+    }
+    std::sort(medians.begin(), medians.end());
+    summary.low = medians[static_cast<std::size_t>(0.025 * (medians.size() - 1))];
+    summary.high = medians[static_cast<std::size_t>(0.975 * (medians.size() - 1))];
+    return summary;
+}
+
+
+// Baselines are stored as a plain text file, one scenario per line: "name median mad".
+// Plain text means you can diff it, and commit it next to the code if you want.
+inline std::map<std::string, BenchSummary> loadBaseline(const std::string& path)
+{
+    std::map<std::string, BenchSummary> baseline;
+    std::ifstream input(path);
+    std::string line;
+    while (std::getline(input, line))
+    {
+        std::istringstream fields(line);
+        std::string name;
+        BenchSummary summary;
+        if (fields >> name >> summary.median >> summary.mad)
+        {
+            baseline[name] = summary;
+        }
+    }
+    return baseline;
+}
+
+inline bool saveBaseline(const std::string& path, const std::map<std::string, BenchSummary>& results)
+{
+    std::ofstream output(path);
+    for (const auto& result : results)
+    {
+        output << result.first << ' ' << result.second.median << ' ' << result.second.mad << '\n';
+    }
+    return static_cast<bool>(output);
+}
+
+
+// A scenario has regressed when it got more than `threshold` slower (0.05 = 5%)
+// AND even the optimistic end of its confidence interval is slower than that. Otherwise it's probably just noise.
+inline bool isRegression(const BenchSummary& baseline, const BenchSummary& current, double threshold)
+{
+    double limit = baseline.median * (1.0 + threshold);
+    return current.median > limit && current.low > limit;
+}
@@ -0,0 +1,305 @@
+/*
+Borrowed Pointers
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+// Passing a shared_ptr<Person> by value just to read person->name costs an atomic increment on the way in
+// and an atomic decrement on the way out. The function doesn't want to OWN the person, it just wants to look.
+//
+// borrowed_ptr<T> is for looking. It doesn't own anything, it's just a pointer that says so in its type:
+//
+//     void greet(borrowed_ptr<Person> person) { std::cout << person->name; }
+//     greet(professor);       // professor is a shared_ptr (or unique_ptr), no reference count is touched
+//
+// The rule is the same as for a raw pointer: the owner has to outlive the borrow.
+//
+// In release builds borrowed_ptr is exactly a raw pointer. In debug builds (_DEBUG, or BORROWED_PTR_CHECKS=1) it checks that rule:
+//   - borrowed from a shared_ptr: it keeps a weak_ptr on the side and checks it hasn't expired.
+//   - borrowed from a class that inherits BorrowChecked: the object's address gets a new "generation" number when it's destroyed,
+//     so a borrow made before that is caught, even if a new object was built at the same address since.
+// Using a dead borrow prints a message and aborts, right where the bug is, instead of corrupting memory somewhere else.
+
+#ifndef BORROWED_PTR_CHECKS
+#ifdef _DEBUG
+#define BORROWED_PTR_CHECKS 1
+#else
+#define BORROWED_PTR_CHECKS 0
+#endif
+#endif
+
+
+// Generation numbers per address, for classes that inherit BorrowChecked.
+// Only addresses that are borrowed right now have an entry: the last borrow to go takes it away,
+// so a long run doesn't collect one for every object it ever borrowed.
+class BorrowRegistry
+{
+public:
+    static BorrowRegistry& instance()
+    {
+        static BorrowRegistry registry;
+        return registry;
+    }
+
+    // A new borrow of `address`. Returns the generation it's borrowing.
+    std::uint64_t borrow(const void* address)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries[address];
+        entry.borrows++;
+        return entry.generation;
+    }
+
+    // A copy of a borrow: one more to wait for, whatever generation it has.
+    void share(const void* address)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[address].borrows++;
+    }
+
+    void giveBack(const void* address)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(address);
+        if (--found->second.borrows == 0)
+        {
+            entries.erase(found);
+        }
+    }
+
+    // Only called with a borrow of `address` alive, so it has an entry.
+    std::uint64_t generation(const void* address)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.find(address)->second.generation;
+    }
+
+    void retire(const void* address)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(address);
+        if (found != entries.end())     // Nobody borrowed it, so there's nobody to tell.
+        {
+            found->second.generation++;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        std::uint64_t generation = 0;
+        std::size_t borrows = 0;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<const void*, Entry> entries;
+};
+
+
+// Inherit this to let debug builds catch dead borrows of your class, even from unique_ptrs and plain objects.
+class BorrowChecked
+{
+public:
+#if BORROWED_PTR_CHECKS
+    ~BorrowChecked()
+    {
+        BorrowRegistry::instance().retire(this);
+    }
+#endif
+
+    // Copying an object doesn't move its borrows, so these stay trivial on purpose.
+    BorrowChecked() = default;
+    BorrowChecked(const BorrowChecked&) = default;
+    BorrowChecked& operator=(const BorrowChecked&) = default;
+};
+
+
+template<class T>
+class borrowed_ptr
+{
+public:
+    borrowed_ptr() = default;
+    borrowed_ptr(std::nullptr_t) {}
+
+    borrowed_ptr(T& object) : pointer(&object)
+    {
+        remember();
+    }
+
+    template<class U, class Deleter, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    borrowed_ptr(const std::unique_ptr<U, Deleter>& owner) : pointer(owner.get())
+    {
+        remember();
+    }
+
+    template<class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    borrowed_ptr(const std::shared_ptr<U>& owner) : pointer(owner.get())
+    {
+#if BORROWED_PTR_CHECKS
+        watch = owner;
+        watched = true;
+#endif
+        remember();
+    }
+
+    // Borrowing from a temporary would dangle before the next line, so it doesn't compile.
+    template<class U, class Deleter>
+    borrowed_ptr(std::unique_ptr<U, Deleter>&&) = delete;
+    template<class U>
+    borrowed_ptr(std::shared_ptr<U>&&) = delete;
+
+    template<class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    borrowed_ptr(const borrowed_ptr<U>& other) : pointer(other.pointer)
+    {
+        copyChecks(other);
+    }
+
+#if BORROWED_PTR_CHECKS
+    // Every copy counts as a borrow in the registry, until it goes away.
+    borrowed_ptr(const borrowed_ptr& other) : pointer(other.pointer)
+    {
+        copyChecks(other);
+    }
+
+    borrowed_ptr& operator=(const borrowed_ptr& other)
+    {
+        borrowed_ptr copy(other);
+        std::swap(pointer, copy.pointer);
+        std::swap(watch, copy.watch);
+        std::swap(watched, copy.watched);
+        std::swap(generationAddress, copy.generationAddress);
+        std::swap(generation, copy.generation);
+        return *this;
+    }
+
+    ~borrowed_ptr()
+    {
+        if (generationAddress != nullptr)
+        {
+            BorrowRegistry::instance().giveBack(generationAddress);
+        }
+    }
+#endif
+
+    T* get() const
+    {
+        check();
+        return pointer;
+    }
+
+    T& operator*() const { return *get(); }
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return pointer != nullptr; }
+
+    // Comparing only looks at the address, so it's fine even after the object is gone.
+    friend bool operator==(const borrowed_ptr& a, const borrowed_ptr& b) { return a.pointer == b.pointer; }
+    friend bool operator!=(const borrowed_ptr& a, const borrowed_ptr& b) { return a.pointer != b.pointer; }
+    friend bool operator==(const borrowed_ptr& a, std::nullptr_t) { return a.pointer == nullptr; }
+    friend bool operator!=(const borrowed_ptr& a, std::nullptr_t) { return a.pointer != nullptr; }
+
+    // Is the object still there? Always true in release builds, it can't tell.
+    bool alive() const
+    {
+#if BORROWED_PTR_CHECKS
+        if (pointer == nullptr)
+        {
+            return true;
+        }
+        if (watched && watch.expired())
+        {
+            return false;
+        }
+        if (generationAddress != nullptr && BorrowRegistry::instance().generation(generationAddress) != generation)
+        {
+            return false;
+        }
+#endif
+        return true;
+    }
+
+private:
+    template<class U>
+    friend class borrowed_ptr;
+
+    T* pointer = nullptr;
+
+#if BORROWED_PTR_CHECKS
+    std::weak_ptr<const void> watch;
+    bool watched = false;
+    const void* generationAddress = nullptr;
+    std::uint64_t generation = 0;
+#endif
+
+    template<class U>
+    void copyChecks(const borrowed_ptr<U>& other)
+    {
+#if BORROWED_PTR_CHECKS
+        watch = other.watch;
+        watched = other.watched;
+        generation = other.generation;
+        generationAddress = other.generationAddress;
+        if (generationAddress != nullptr)
+        {
+            BorrowRegistry::instance().share(generationAddress);
+        }
+#else
+        (void)other;
+#endif
+    }
+
+    void remember()
+    {
+#if BORROWED_PTR_CHECKS
+        rememberGeneration(pointer, std::is_base_of<BorrowChecked, T>());
+#endif
+    }
+
+#if BORROWED_PTR_CHECKS
+    void rememberGeneration(T* object, std::true_type)
+    {
+        if (object != nullptr)
+        {
+            generationAddress = static_cast<const BorrowChecked*>(object);
+            generation = BorrowRegistry::instance().borrow(generationAddress);
+        }
+    }
+
+    void rememberGeneration(T*, std::false_type) {}
+#endif
+
+    void check() const
+    {
+#if BORROWED_PTR_CHECKS
+        if (!alive())
+        {
+            std::cerr << "borrowed_ptr: the object was destroyed while it was still borrowed" << std::endl;
+            std::abort();
+        }
+#endif
+    }
+};
+
+#if !BORROWED_PTR_CHECKS
+static_assert(sizeof(borrowed_ptr<int>) == sizeof(int*), "release borrowed_ptr should be just a pointer");
+static_assert(std::is_trivially_copyable<borrowed_ptr<int>>::value, "release borrowed_ptr should copy like a pointer");
+#endif
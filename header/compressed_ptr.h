@@ -0,0 +1,374 @@
+/*
+Compressed Pointers
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// On a 64 bit machine a unique_ptr<Person> is 8 bytes and a shared_ptr<Person> is 16.
+// If all of our people live in one big block of memory (a "region"), we don't need a whole address to find one,
+// just how far into the region it is. 32 bits of that is plenty:
+//
+//     address = region base + offset * 8      (everything in the region is 8 byte aligned, so we count in 8 byte steps)
+//
+// That reaches 32 GB with a 4 byte pointer.
+//
+//   CompressedRegion          reserves the address space up front and hands out memory from it (the OS only gives us
+//                             real pages as we touch them). Freed blocks go on a free list for their size.
+//   CompressedUniquePtr<T>    4 bytes, owns its object like unique_ptr.
+//   CompressedSharedPtr<T>    4 bytes, reference counted like shared_ptr (the 4 byte count lives in front of the object).
+//
+// The catch: a compressed pointer doesn't know which region it's in (that would take another 8 bytes).
+// So the region is picked by the code using the pointers, one thread at a time, with a scope:
+//
+//     CompressedRegion people;
+//     CompressedRegion::Scope use(people);       // From here to the end of the block, this thread's pointers are into `people`.
+//     CompressedSharedPtr<Person> professor = makeCompressedShared<Person>("Professor");
+//
+// Every thread that makes, reads or lets go of compressed pointers needs a Scope for their region
+// (a CompressedSharedPtr released on another thread included). Scopes nest, the innermost one wins.
+// The region has to outlive all of its pointers and scopes. Debug builds assert on a missing scope, on offsets
+// past what the region has handed out (usually a pointer from another region), and on a region destroyed too early.
+// Allocating and freeing take a lock, so any thread can do them. The counts themselves are atomic.
+
+class CompressedRegion
+{
+public:
+    static const std::size_t Granularity = 8;                                                   // Offsets count in steps of this many bytes.
+    static const std::uint64_t MaxBytes = (static_cast<std::uint64_t>(1) << 32) * Granularity;  // 32 GB.
+
+    explicit CompressedRegion(std::uint64_t bytes = static_cast<std::uint64_t>(4) << 30) : capacity(bytes < MaxBytes ? bytes : MaxBytes)
+    {
+#ifdef _WIN32
+        base = static_cast<char*>(VirtualAlloc(nullptr, static_cast<SIZE_T>(capacity), MEM_RESERVE, PAGE_NOACCESS));
+#else
+        void* memory = mmap(nullptr, static_cast<std::size_t>(capacity), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        base = memory == MAP_FAILED ? nullptr : static_cast<char*>(memory);
+#endif
+        if (base == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        used = Granularity;     // Offset 0 means nullptr, so nothing can live there.
+        committed = 0;
+    }
+
+    ~CompressedRegion()
+    {
+        assert(scopes.load() == 0 && "CompressedRegion destroyed inside a Scope that uses it");
+        assert(live == 0 && "CompressedRegion destroyed while pointers into it are still around");
+#ifdef _WIN32
+        VirtualFree(base, 0, MEM_RELEASE);
+#else
+        munmap(base, static_cast<std::size_t>(capacity));
+#endif
+    }
+
+    CompressedRegion(const CompressedRegion&) = delete;
+    CompressedRegion& operator=(const CompressedRegion&) = delete;
+
+    // Makes `region` the one this thread's compressed pointers are in, until the scope ends.
+    class Scope
+    {
+    public:
+        explicit Scope(CompressedRegion& region) : region(region), previous(active)
+        {
+            active = &region;
+            region.scopes++;
+        }
+
+        ~Scope()
+        {
+            assert(active == &region && "CompressedRegion::Scopes have to end in the reverse order they started");
+            region.scopes--;
+            active = previous;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CompressedRegion& region;
+        CompressedRegion* previous;
+    };
+
+    std::uint32_t allocate(std::size_t bytes)
+    {
+        std::size_t steps = stepsFor(bytes);
+        std::lock_guard<std::mutex> lock(mutex);
+        live++;
+        if (steps < freeLists.size() && freeLists[steps] != 0)
+        {
+            std::uint32_t offset = freeLists[steps];
+            freeLists[steps] = *static_cast<std::uint32_t*>(at(offset));   // A free block keeps the offset of the next one in its first 4 bytes.
+            return offset;
+        }
+
+        std::uint64_t start = used.load(std::memory_order_relaxed);
+        if (start + steps * Granularity > capacity)
+        {
+            live--;
+            throw std::bad_alloc();
+        }
+        commit(start + steps * Granularity);
+        used.store(start + steps * Granularity, std::memory_order_relaxed);
+        return static_cast<std::uint32_t>(start / Granularity);
+    }
+
+    void deallocate(std::uint32_t offset, std::size_t bytes)
+    {
+        std::size_t steps = stepsFor(bytes);
+        std::lock_guard<std::mutex> lock(mutex);
+        live--;
+        if (steps >= freeLists.size())
+        {
+            freeLists.resize(steps + 1, 0);
+        }
+        *static_cast<std::uint32_t*>(at(offset)) = freeLists[steps];
+        freeLists[steps] = offset;
+    }
+
+    void* at(std::uint32_t offset) const
+    {
+        assert(static_cast<std::uint64_t>(offset) * Granularity < used.load(std::memory_order_relaxed) && "compressed pointer past the end of its region (is the right Scope open?)");
+        return base + static_cast<std::uint64_t>(offset) * Granularity;
+    }
+
+    // How much of the region has been handed out so far (freed blocks included).
+    std::uint64_t bytesUsed() const { return used.load(std::memory_order_relaxed); }
+
+    // The region of the innermost Scope on this thread.
+    static CompressedRegion& current()
+    {
+        assert(active != nullptr && "compressed pointers used without a CompressedRegion::Scope on this thread");
+        return *active;
+    }
+
+private:
+    char* base = nullptr;
+    std::uint64_t capacity = 0;
+    std::atomic<std::uint64_t> used{ 0 };   // Only grows. Atomic so at() can check offsets against it from any thread.
+    std::uint64_t committed = 0;
+    std::vector<std::uint32_t> freeLists;   // By size, in steps. 0 is an empty list.
+    std::size_t live = 0;                   // Blocks handed out and not freed yet.
+    std::mutex mutex;                       // For allocate and deallocate.
+    std::atomic<int> scopes{ 0 };
+
+    inline static thread_local CompressedRegion* active = nullptr;
+
+    static std::size_t stepsFor(std::size_t bytes)
+    {
+        std::size_t steps = (bytes + Granularity - 1) / Granularity;
+        return steps == 0 ? 1 : steps;
+    }
+
+    // Linux hands out pages as they're touched, Windows wants us to ask first (1 MB at a time).
+    void commit(std::uint64_t upTo)
+    {
+#ifdef _WIN32
+        const std::uint64_t chunk = 1 << 20;
+        while (committed < upTo)
+        {
+            std::uint64_t size = committed + chunk > capacity ? capacity - committed : chunk;
+            if (VirtualAlloc(base + committed, static_cast<SIZE_T>(size), MEM_COMMIT, PAGE_READWRITE) == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            committed += size;
+        }
+#else
+        committed = upTo;
+#endif
+    }
+};
+
+
+template<class T>
+class CompressedUniquePtr
+{
+public:
+    CompressedUniquePtr() = default;
+    CompressedUniquePtr(std::nullptr_t) {}
+
+    CompressedUniquePtr(CompressedUniquePtr&& other) noexcept : offset(std::exchange(other.offset, 0)) {}
+
+    CompressedUniquePtr& operator=(CompressedUniquePtr&& other) noexcept
+    {
+        std::uint32_t taken = std::exchange(other.offset, 0);  // Take it first: other might live inside the object we're about to delete.
+        reset();
+        offset = taken;
+        return *this;
+    }
+
+    CompressedUniquePtr(const CompressedUniquePtr&) = delete;
+    CompressedUniquePtr& operator=(const CompressedUniquePtr&) = delete;
+
+    ~CompressedUniquePtr()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        std::uint32_t old = std::exchange(offset, 0);
+        if (old != 0)
+        {
+            static_cast<T*>(CompressedRegion::current().at(old))->~T();
+            CompressedRegion::current().deallocate(old, sizeof(T));
+        }
+    }
+
+    T* get() const { return offset == 0 ? nullptr : static_cast<T*>(CompressedRegion::current().at(offset)); }
+    T& operator*() const { return *get(); }
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return offset != 0; }
+
+private:
+    template<class U, class... Args>
+    friend CompressedUniquePtr<U> makeCompressedUnique(Args&&... args);
+
+    std::uint32_t offset = 0;
+};
+
+
+template<class T, class... Args>
+CompressedUniquePtr<T> makeCompressedUnique(Args&&... args)
+{
+    static_assert(alignof(T) <= CompressedRegion::Granularity, "the region only lines things up on 8 bytes");
+
+    CompressedRegion& region = CompressedRegion::current();
+    std::uint32_t offset = region.allocate(sizeof(T));
+    try
+    {
+        new (region.at(offset)) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        region.deallocate(offset, sizeof(T));
+        throw;
+    }
+    CompressedUniquePtr<T> pointer;
+    pointer.offset = offset;
+    return pointer;
+}
+
+
+namespace compressed_detail
+{
+    template<class T>
+    struct CountedBox
+    {
+        std::atomic<std::uint32_t> count{ 1 };     // 4 bytes is enough, there can't be more than 2^32 pointers to it in the region anyway.
+        T value;
+
+        template<class... Args>
+        explicit CountedBox(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+}
+
+
+template<class T>
+class CompressedSharedPtr
+{
+    using Box = compressed_detail::CountedBox<T>;
+
+public:
+    CompressedSharedPtr() = default;
+    CompressedSharedPtr(std::nullptr_t) {}
+
+    CompressedSharedPtr(const CompressedSharedPtr& other) : offset(other.offset)
+    {
+        if (offset != 0)
+        {
+            box()->count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    CompressedSharedPtr(CompressedSharedPtr&& other) noexcept : offset(std::exchange(other.offset, 0)) {}
+
+    CompressedSharedPtr& operator=(CompressedSharedPtr other) noexcept
+    {
+        std::swap(offset, other.offset);
+        return *this;
+    }
+
+    ~CompressedSharedPtr()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        Box* object = box();
+        std::uint32_t old = std::exchange(offset, 0);
+        if (old != 0 && object->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            object->~Box();
+            CompressedRegion::current().deallocate(old, sizeof(Box));
+        }
+    }
+
+    T* get() const { return offset == 0 ? nullptr : &box()->value; }
+    T& operator*() const { return box()->value; }
+    T* operator->() const { return &box()->value; }
+    explicit operator bool() const { return offset != 0; }
+    long use_count() const { return offset == 0 ? 0 : static_cast<long>(box()->count.load(std::memory_order_relaxed)); }
+
+private:
+    template<class U, class... Args>
+    friend CompressedSharedPtr<U> makeCompressedShared(Args&&... args);
+
+    std::uint32_t offset = 0;
+
+    Box* box() const { return offset == 0 ? nullptr : static_cast<Box*>(CompressedRegion::current().at(offset)); }
+};
+
+
+// Like make_shared: the count and the object in one block from the region.
+template<class T, class... Args>
+CompressedSharedPtr<T> makeCompressedShared(Args&&... args)
+{
+    using Box = compressed_detail::CountedBox<T>;
+    static_assert(alignof(Box) <= CompressedRegion::Granularity, "the region only lines things up on 8 bytes");
+
+    CompressedRegion& region = CompressedRegion::current();
+    std::uint32_t offset = region.allocate(sizeof(Box));
+    try
+    {
+        new (region.at(offset)) Box(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        region.deallocate(offset, sizeof(Box));
+        throw;
+    }
+    CompressedSharedPtr<T> pointer;
+    pointer.offset = offset;
+    return pointer;
+}
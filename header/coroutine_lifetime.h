@@ -0,0 +1,279 @@
+/*
+Coroutines and Object Lifetime
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// C++20 coroutines are functions that can pause (co_await) and pick up later where they left off.
+// Everything a coroutine needs across a pause lives in its "frame", and that includes any shared_ptr it's holding.
+// The easy habit is to hold a shared_ptr<Person> the whole time "just to keep it alive", copying it into every call.
+// Each of those copies is an atomic increment, and each goodbye an atomic decrement.
+//
+// This header has the pieces to do better:
+//   Task<T>        a coroutine that returns a T, and can be co_awaited by another coroutine.
+//   EventLoop      a tiny single threaded scheduler to run them on.
+//   loop.lock(w)   pauses, then locks the weak_ptr when we come back. While paused we only hold the weak_ptr,
+//                  so we don't keep the person alive (or touch the strong count) while waiting.
+//   Owned<T>       a shared_ptr that can only be moved, never copied. Pass it into coroutines and across co_await
+//                  and the reference count never moves. If you really want another reference, you have to ask (share()).
+//
+// Needs a C++20 compiler. On older compilers this header is empty.
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+template<class T, class Pointer = std::shared_ptr<T>>
+class Owned
+{
+public:
+    Owned() = default;
+    explicit Owned(Pointer&& pointer) : pointer(std::move(pointer)) {}
+
+    Owned(Owned&&) noexcept = default;
+    Owned& operator=(Owned&&) noexcept = default;
+    Owned(const Owned&) = delete;               // This is the whole point.
+    Owned& operator=(const Owned&) = delete;
+
+    T* get() const { return pointer.get(); }
+    T* operator->() const { return pointer.get(); }
+    T& operator*() const { return *pointer; }
+    explicit operator bool() const { return pointer != nullptr; }
+
+    // An extra strong reference, on purpose.
+    Pointer share() const { return pointer; }
+
+    // Gives the pointer back and leaves this empty.
+    Pointer release() { return std::move(pointer); }
+
+private:
+    Pointer pointer;
+};
+
+
+template<class T = void>
+class Task;
+
+namespace task_detail
+{
+    // The part of the promise that doesn't care about the result type.
+    struct PromiseBase
+    {
+        std::coroutine_handle<> continuation;   // Whoever is co_awaiting us, resumed when we finish.
+        std::exception_ptr exception;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }   // Tasks are lazy, nothing runs until someone awaits or spawns them.
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            template<class Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+            {
+                std::coroutine_handle<> next = finished.promise().continuation;
+                return next ? next : std::noop_coroutine();            // Jump straight back into the awaiting coroutine.
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    template<class T>
+    struct Promise : PromiseBase
+    {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+        template<class U>
+        void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+        T take()
+        {
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase
+    {
+        Task<void> get_return_object();
+        void return_void() {}
+
+        void take()
+        {
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+}
+
+
+template<class T>
+class Task
+{
+public:
+    using promise_type = task_detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        destroy();
+    }
+
+    bool done() const { return !handle || handle.done(); }
+
+    // The result, once the task has finished (rethrows if the coroutine threw).
+    T result() { return handle.promise().take(); }
+
+    // co_await task: start it, and come back here with its result when it's done.
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return handle.promise().take(); }
+
+private:
+    friend class EventLoop;
+    std::coroutine_handle<promise_type> handle;
+
+    void destroy()
+    {
+        if (handle)
+        {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+};
+
+namespace task_detail
+{
+    template<class T>
+    Task<T> Promise<T>::get_return_object() { return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this)); }
+
+    inline Task<void> Promise<void>::get_return_object() { return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this)); }
+}
+
+
+// Runs coroutines one at a time on the thread that calls run().
+// A coroutine that co_awaits yield() or lock() goes to the back of the line, and the next one gets a turn.
+class EventLoop
+{
+public:
+    // Starts a task on this loop. The loop keeps it alive until it finishes.
+    void spawn(Task<void>&& task)
+    {
+        ready.push_back(task.handle);
+        tasks.push_back(std::move(task));
+    }
+
+    // Resumes coroutines until none of them have anything left to do.
+    void run()
+    {
+        while (!ready.empty())
+        {
+            std::coroutine_handle<> next = ready.front();
+            ready.pop_front();
+            next.resume();
+        }
+
+        // Finished tasks can go now. (Rethrows the first exception one of them threw.)
+        std::vector<Task<void>> finished;
+        for (std::size_t i = 0; i < tasks.size();)
+        {
+            if (tasks[i].done())
+            {
+                finished.push_back(std::move(tasks[i]));
+                tasks[i] = std::move(tasks.back());
+                tasks.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+        for (Task<void>& task : finished)
+        {
+            task.result();
+        }
+    }
+
+    // co_await loop.yield(): let the other coroutines have a turn.
+    auto yield()
+    {
+        struct Awaiter
+        {
+            EventLoop& loop;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { loop.ready.push_back(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+
+    // co_await loop.lock(weakPtr): let the other coroutines have a turn, then lock the weak_ptr.
+    // Gives back nullptr if the object died while we were waiting, just like weak_ptr::lock.
+    template<class T>
+    auto lock(std::weak_ptr<T> weak)
+    {
+        struct Awaiter
+        {
+            EventLoop& loop;
+            std::weak_ptr<T> weak;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { loop.ready.push_back(handle); }
+            std::shared_ptr<T> await_resume() const { return weak.lock(); }
+        };
+        return Awaiter{ *this, std::move(weak) };
+    }
+
+private:
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<Task<void>> tasks;
+};
+
+#endif
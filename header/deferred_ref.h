@@ -0,0 +1,400 @@
+/*
+Deferred Reference Counting
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Most shared_ptr copies don't last: `std::shared_ptr<Person> temp = weakPtr.lock();`, a parameter passed by value,
+// a local that's gone at the end of the function. Each one still counts up on the way in and down on the way out.
+//
+// Deferred reference counting (Deutsch and Bobrow, 1976) only counts the references that are stored somewhere
+// that outlives a function call: inside other objects, in containers, in globals. Those are HeapRefs.
+// References held by local variables are LocalRefs, and aren't counted at all:
+//
+//     LocalRef<Person> professor = makeDeferred<Person>("Professor");
+//     blossom->parent = professor;                // HeapRef: counted.
+//     LocalRef<Person> parent = blossom->parent;  // LocalRef: not counted.
+//     greet(parent);                              // Passed by value: not counted either.
+//
+// The catch: when a HeapRef count reaches 0 we can't tell if some local still points at the object.
+// So it isn't freed right away. It goes into the "zero count table", and gets decided on later, by reconcile():
+// every object in the table that still has no HeapRefs and no LocalRef pointing at it is destroyed.
+//
+// To know what the locals point at, the original scans the machine stack. We can't portably do that, so every
+// LocalRef writes its object onto a "shadow stack" (a plain vector, one per thread) instead. That's still no
+// atomics and nothing written into the object itself, so locals never touch the object's cache line.
+//
+// reconcile() happens:
+//   - periodically: when the table gets to reconcileEvery entries (1024 unless you setReconcileEvery()),
+//   - at the end of a DeferredScope (say one per request), which is a good place because the request's locals are gone.
+//
+// One heap per thread, objects must stay on the thread that made them (the counts aren't atomic, that's the point).
+// Only LocalRef and HeapRef keep things alive. A raw pointer or a Person& doesn't, just like with shared_ptr.
+
+template<class T>
+class HeapRef;
+template<class T>
+class LocalRef;
+
+namespace deferred_detail
+{
+    struct Header
+    {
+        std::size_t count = 0;              // HeapRefs only.
+        bool inTable = false;               // In the zero count table.
+        bool rooted = false;                // A LocalRef points here (only meaningful during reconcile).
+        void (*destroy)(Header*) = nullptr;
+    };
+
+    template<class T>
+    struct Box : Header
+    {
+        T value;
+
+        template<class... Args>
+        explicit Box(Args&&... args) : value(std::forward<Args>(args)...)
+        {
+            destroy = [](Header* header) { delete static_cast<Box*>(header); };
+        }
+    };
+}
+
+
+class DeferredHeap
+{
+public:
+    typedef deferred_detail::Header Header;
+
+    // What the heap has been up to. "Operations" are increments and decrements (a LocalRef made and let go is two).
+    struct Stats
+    {
+        std::uint64_t counted = 0;          // By HeapRefs.
+        std::uint64_t uncounted = 0;        // By LocalRefs: what a shared_ptr would have counted, and we didn't.
+        std::uint64_t reconciles = 0;
+        std::uint64_t freed = 0;
+    };
+
+    DeferredHeap(const DeferredHeap&) = delete;
+    DeferredHeap& operator=(const DeferredHeap&) = delete;
+
+    ~DeferredHeap()
+    {
+        reconcile();    // Whatever a HeapRef still holds is left alone. (So don't keep them in globals: they'd outlive the heap)
+    }
+
+    // This thread's heap.
+    static DeferredHeap& local()
+    {
+        static thread_local DeferredHeap heap;
+        return heap;
+    }
+
+    void setReconcileEvery(std::size_t entries)
+    {
+        reconcileEvery = entries;
+        nextReconcile = entries;
+    }
+
+    // Destroys everything in the zero count table that no HeapRef or LocalRef points at.
+    // Returns how many objects were destroyed (including ones that only lost their last HeapRef to another one's destructor).
+    std::size_t reconcile()
+    {
+        if (reconciling)
+        {
+            return 0;   // Called from a destructor we're running: the loop below will get to it.
+        }
+        reconciling = true;
+        stats.reconciles++;
+
+        marked.clear();     // Not `roots` itself: a destructor below could let go of a LocalRef it kept in a member.
+        for (Header* root : roots)
+        {
+            if (root != nullptr && !root->rooted)
+            {
+                root->rooted = true;
+                marked.push_back(root);
+            }
+        }
+
+        std::size_t freed = 0;
+        bool progress = true;
+        while (progress)
+        {
+            progress = false;
+            candidates.clear();
+            candidates.swap(table);     // Destructors below can add to the table, they add to the fresh one.
+            for (Header* header : candidates)
+            {
+                if (header->count != 0)
+                {
+                    header->inTable = false;        // A HeapRef picked it up again.
+                }
+                else if (header->rooted)
+                {
+                    table.push_back(header);        // A local is still using it: try again next time.
+                }
+                else
+                {
+                    header->destroy(header);
+                    freed++;
+                    progress = true;
+                }
+            }
+        }
+
+        for (Header* root : marked)
+        {
+            root->rooted = false;
+        }
+
+        stats.freed += freed;
+        nextReconcile = table.size() + reconcileEvery;      // What's left is rooted, don't reconcile again for just that.
+        reconciling = false;
+        return freed;
+    }
+
+    // Objects waiting in the zero count table.
+    std::size_t pending() const { return table.size(); }
+
+    const Stats& statistics() const { return stats; }
+    void resetStatistics() { stats = Stats(); }
+
+private:
+    template<class T>
+    friend class HeapRef;
+    template<class T>
+    friend class LocalRef;
+    template<class T, class... Args>
+    friend LocalRef<T> makeDeferred(Args&&... args);
+
+    std::vector<Header*> table;     // The zero count table.
+    std::vector<Header*> roots;     // The shadow stack: one entry per live LocalRef (nullptr once it's gone).
+    std::vector<Header*> marked;    // reconcile()'s scratch space, kept so it doesn't allocate every time.
+    std::vector<Header*> candidates;
+    std::size_t reconcileEvery = 1024;
+    std::size_t nextReconcile = 1024;
+    bool reconciling = false;
+    Stats stats;
+
+    DeferredHeap() = default;
+
+    void addCount(Header* header)
+    {
+        header->count++;
+        stats.counted++;
+    }
+
+    void dropCount(Header* header)
+    {
+        stats.counted++;
+        if (--header->count == 0)
+        {
+            zeroCount(header);
+        }
+    }
+
+    void zeroCount(Header* header)
+    {
+        if (!header->inTable)
+        {
+            header->inTable = true;
+            table.push_back(header);
+            if (table.size() >= nextReconcile)
+            {
+                reconcile();
+            }
+        }
+    }
+
+    std::size_t root(Header* header)
+    {
+        stats.uncounted++;
+        roots.push_back(header);
+        return roots.size() - 1;
+    }
+
+    void unroot(std::size_t slot)
+    {
+        stats.uncounted++;
+        roots[slot] = nullptr;
+        while (!roots.empty() && roots.back() == nullptr)
+        {
+            roots.pop_back();   // Locals almost always go away in the reverse order they were made, so this stays short.
+        }
+    }
+};
+
+
+// A reference held by a local variable (or a parameter, or a temporary). Not counted.
+// Keep these on the stack: one stored in a heap object works, but keeps its object alive until it's destroyed, uncounted.
+template<class T>
+class LocalRef
+{
+    typedef deferred_detail::Box<T> Box;
+
+public:
+    LocalRef() = default;
+    LocalRef(std::nullptr_t) {}
+
+    LocalRef(const HeapRef<T>& heap) : LocalRef(heap.box) {}
+
+    LocalRef(const LocalRef& other) : LocalRef(other.box) {}
+
+    LocalRef(LocalRef&& other) noexcept : box(std::exchange(other.box, nullptr)), slot(other.slot) {}
+
+    LocalRef& operator=(LocalRef other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~LocalRef()
+    {
+        if (box != nullptr)
+        {
+            DeferredHeap::local().unroot(slot);
+        }
+    }
+
+    void reset()
+    {
+        LocalRef().swap(*this);
+    }
+
+    // The slots get swapped too: each one still says which object its LocalRef points at.
+    void swap(LocalRef& other) noexcept
+    {
+        std::swap(box, other.box);
+        std::swap(slot, other.slot);
+    }
+
+    T* get() const { return box == nullptr ? nullptr : &box->value; }
+    T& operator*() const { return box->value; }
+    T* operator->() const { return &box->value; }
+    explicit operator bool() const { return box != nullptr; }
+    bool operator==(std::nullptr_t) const { return box == nullptr; }
+
+private:
+    template<class U>
+    friend class HeapRef;
+    template<class U, class... Args>
+    friend LocalRef<U> makeDeferred(Args&&... args);
+
+    Box* box = nullptr;
+    std::size_t slot = 0;       // Where we are on the shadow stack.
+
+    explicit LocalRef(Box* box) : box(box)
+    {
+        if (box != nullptr)
+        {
+            slot = DeferredHeap::local().root(box);
+        }
+    }
+};
+
+
+// A reference stored somewhere that outlives a function call: a member, a container, a global. Counted.
+template<class T>
+class HeapRef
+{
+    typedef deferred_detail::Box<T> Box;
+
+public:
+    HeapRef() = default;
+    HeapRef(std::nullptr_t) {}
+
+    HeapRef(const LocalRef<T>& local) : HeapRef(local.box) {}
+
+    HeapRef(const HeapRef& other) : HeapRef(other.box) {}
+
+    HeapRef(HeapRef&& other) noexcept : box(std::exchange(other.box, nullptr)) {}
+
+    HeapRef& operator=(HeapRef other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~HeapRef()
+    {
+        if (box != nullptr)
+        {
+            DeferredHeap::local().dropCount(box);     // At 0 it only goes into the table, reconcile() decides.
+        }
+    }
+
+    void reset()
+    {
+        HeapRef().swap(*this);
+    }
+
+    void swap(HeapRef& other) noexcept
+    {
+        std::swap(box, other.box);
+    }
+
+    T* get() const { return box == nullptr ? nullptr : &box->value; }
+    T& operator*() const { return box->value; }
+    T* operator->() const { return &box->value; }
+    explicit operator bool() const { return box != nullptr; }
+    bool operator==(std::nullptr_t) const { return box == nullptr; }
+    std::size_t use_count() const { return box == nullptr ? 0 : box->count; }     // HeapRefs only, locals aren't counted.
+
+private:
+    template<class U>
+    friend class LocalRef;
+
+    Box* box = nullptr;
+
+    explicit HeapRef(Box* box) : box(box)
+    {
+        if (box != nullptr)
+        {
+            DeferredHeap::local().addCount(box);
+        }
+    }
+};
+
+
+// Like make_shared. A new object starts with no HeapRefs, so it goes straight into the zero count table,
+// and the LocalRef we return is what keeps it alive until someone stores it.
+template<class T, class... Args>
+LocalRef<T> makeDeferred(Args&&... args)
+{
+    deferred_detail::Box<T>* box = new deferred_detail::Box<T>(std::forward<Args>(args)...);
+    LocalRef<T> local(box);
+    DeferredHeap::local().zeroCount(box);   // Rooted first, so a reconcile this sets off won't take it.
+    return local;
+}
+
+
+// Reconciles when the scope ends. Put one around each request (or frame, or batch), where the locals have just gone away.
+class DeferredScope
+{
+public:
+    DeferredScope() = default;
+    DeferredScope(const DeferredScope&) = delete;
+    DeferredScope& operator=(const DeferredScope&) = delete;
+
+    ~DeferredScope()
+    {
+        DeferredHeap::local().reconcile();
+    }
+};
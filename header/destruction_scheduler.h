@@ -0,0 +1,179 @@
+/*
+Destruction Scheduling
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// When joe goes away, "Joe the second" and "Joe the first" go with him, right then, in whatever order the destructors call each other.
+// That's fine for three Joes. It's not fine in a game, where letting go of a level's worth of textures in one frame
+// means that frame takes 200 ms.
+//
+// A DestructionScheduler takes over the job of letting go:
+//
+//     std::unique_ptr<Person> first = std::move(joe->parent->parent);     // main.cpp's Joes, taken apart.
+//     std::unique_ptr<Person> second = std::move(joe->parent);
+//     DestructionScheduler::Ticket secondGone = scheduler.retire(std::move(second));
+//     DestructionScheduler::Ticket firstGone = scheduler.retire(std::move(first), { secondGone });    // Only after the second is gone.
+//
+//     // Once per frame:
+//     scheduler.tick(1000, 500);      // At most 1000 objects, or 500 microseconds, whichever comes first.
+//
+// Each retired object gets a ticket, and can list tickets that must be destroyed before it (its "dependencies").
+// tick() destroys objects whose dependencies are all gone, in the order they became ready. That's a topological sort
+// (Kahn's algorithm) done a little at a time: retire the same things in the same order and they're destroyed in the same order.
+// A ticket can only wait on tickets that already exist, so the dependencies can't go around in a circle
+// and everything retired is destroyed eventually.
+//
+// retire() can be called from any thread. tick() and flush() should be called from one thread (the frame loop),
+// and run the destructors there, outside the lock.
+
+class DestructionScheduler
+{
+public:
+    typedef std::uint64_t Ticket;
+
+    DestructionScheduler() = default;
+
+    DestructionScheduler(const DestructionScheduler&) = delete;
+    DestructionScheduler& operator=(const DestructionScheduler&) = delete;
+
+    ~DestructionScheduler()
+    {
+        flush();
+    }
+
+    // Takes over one reference. The object is destroyed by tick() once every ticket in `after` has been.
+    // (Tickets in `after` that were already destroyed don't count)
+    // (If the scheduler held the last reference. Anyone else still holding one keeps it alive, like always)
+    template<class T>
+    Ticket retire(std::shared_ptr<T> object, std::initializer_list<Ticket> after = {})
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Ticket ticket = nextTicket++;
+        Node& node = nodes[ticket];
+        node.object = std::shared_ptr<void>(std::move(object));
+        for (Ticket dependency : after)
+        {
+            auto found = nodes.find(dependency);
+            if (found != nodes.end())
+            {
+                found->second.dependents.push_back(ticket);
+                node.waitingOn++;
+            }
+        }
+        if (node.waitingOn == 0)
+        {
+            ready.push_back(ticket);
+        }
+        return ticket;
+    }
+
+    // The same for sole ownership. (It becomes a shared_ptr on the way in, which costs a control block)
+    template<class T, class Deleter>
+    Ticket retire(std::unique_ptr<T, Deleter> object, std::initializer_list<Ticket> after = {})
+    {
+        return retire(std::shared_ptr<T>(std::move(object)), after);
+    }
+
+    // Destroys ready objects until `maxObjects` are done or `maxMicros` have passed (0 means no limit for either).
+    // Returns how many were destroyed.
+    std::size_t tick(std::size_t maxObjects, std::uint64_t maxMicros = 0)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::microseconds budget(maxMicros);
+
+        std::size_t destroyed = 0;
+        while (maxObjects == 0 || destroyed < maxObjects)
+        {
+            if (maxMicros != 0 && destroyed != 0 && std::chrono::steady_clock::now() - start >= budget)
+            {
+                break;
+            }
+
+            std::shared_ptr<void> object;
+            Ticket ticket;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ready.empty())
+                {
+                    break;
+                }
+                ticket = ready.front();
+                ready.pop_front();
+                object = std::move(nodes[ticket].object);
+            }
+
+            object.reset();     // The destructor runs here, with the lock let go (it might retire more things).
+            destroyed++;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            finish(ticket);
+        }
+        return destroyed;
+    }
+
+    // Destroys everything that's left, ignoring the limits.
+    void flush()
+    {
+        tick(0);
+    }
+
+    // How many retired objects haven't been destroyed yet.
+    std::size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return nodes.size();
+    }
+
+private:
+    struct Node
+    {
+        std::shared_ptr<void> object;
+        std::size_t waitingOn = 0;
+        std::vector<Ticket> dependents;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<Ticket, Node> nodes;
+    std::deque<Ticket> ready;
+    Ticket nextTicket = 1;
+
+    // The object for `ticket` is gone. Anything that was only waiting on it is ready now.
+    void finish(Ticket ticket)
+    {
+        auto found = nodes.find(ticket);
+        std::vector<Ticket> dependents = std::move(found->second.dependents);
+        nodes.erase(found);
+        for (Ticket dependent : dependents)
+        {
+            auto waiting = nodes.find(dependent);
+            if (waiting != nodes.end() && --waiting->second.waitingOn == 0)
+            {
+                ready.push_back(dependent);
+            }
+        }
+    }
+};
@@ -0,0 +1,253 @@
+/*
+Expiry Notification
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// With Fredzilla, the only way to find out he's gone is to keep asking: weakPtr.lock() == nullptr?
+// A cache full of weak_ptrs has to scan every entry to find the dead ones.
+//
+// Instead, we can have the object tell us when it dies:
+//
+//     std::shared_ptr<Person> fredzilla = makeObservable<Person>("Fredzilla");
+//     onExpire(fredzilla, [](void* cache) { ... }, &cache);        // Called once, right after Fredzilla is deleted.
+//
+//     ExpiryQueue<int> dead;
+//     dead.watch(fredzilla, 42);                                    // When Fredzilla dies, 42 shows up in the queue...
+//     dead.drain([](int key) { cache.erase(key); });                // ...and we drop just that entry.
+//
+// How it works: makeObservable gives the shared_ptr a custom deleter, and shared_ptr keeps the deleter in the control block.
+// std::get_deleter finds it again from any shared_ptr to the object. The deleter holds a list of observers.
+// Adding an observer and firing them all are each a single atomic operation, so nothing ever takes a lock:
+//
+//   - add:    push onto the front of the list with compare_exchange (a "Treiber stack").
+//   - expire: take the whole list with one exchange, and fire everything on it.
+// Those two can't race: adding needs a live shared_ptr to the object (that's how we find the list),
+// and the deleter only runs once there are none left. Several threads adding at once is the only race, and the CAS handles it.
+//
+// Observers can't be removed again, each one fires exactly once, when the object dies.
+
+
+struct ExpiryObserver
+{
+    ExpiryObserver* next = nullptr;
+    void (*fire)(ExpiryObserver* self) = nullptr;      // Fires the observer, and deletes it when it's done with it.
+};
+
+
+class ExpiryList
+{
+public:
+    ExpiryList() = default;
+
+    // shared_ptr wants to move the deleter into the control block. That only happens before anyone can observe it.
+    ExpiryList(ExpiryList&& other) noexcept : head(other.head.exchange(nullptr, std::memory_order_relaxed)) {}
+
+    ExpiryList& operator=(const ExpiryList&) = delete;
+
+    ~ExpiryList()
+    {
+        expire();   // Nothing left by now, the deleter fired them all. Just making sure no observer is ever leaked.
+    }
+
+    // Only while the object is alive (whoever calls this holds a shared_ptr to it).
+    void add(ExpiryObserver* observer)
+    {
+        observer->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(observer->next, observer, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Fires everything added so far. The list is empty afterwards, so the destructor calling it again does nothing.
+    void expire()
+    {
+        ExpiryObserver* observer = head.exchange(nullptr, std::memory_order_acquire);
+        while (observer != nullptr)
+        {
+            ExpiryObserver* next = observer->next;     // Read before firing, fire may delete it.
+            observer->fire(observer);
+            observer = next;
+        }
+    }
+
+private:
+    std::atomic<ExpiryObserver*> head{ nullptr };
+};
+
+
+// The deleter that makeObservable puts in the control block.
+template<class T>
+struct ExpiryDeleter
+{
+    ExpiryList observers;
+
+    void operator()(T* object)
+    {
+        delete object;
+        observers.expire();
+    }
+};
+
+
+template<class T, class... Args>
+std::shared_ptr<T> makeObservable(Args&&... args)
+{
+    return std::shared_ptr<T>(new T(std::forward<Args>(args)...), ExpiryDeleter<T>());
+}
+
+
+// The list of observers for an object, or nullptr if it wasn't made with makeObservable.
+template<class T>
+ExpiryList* expiryListOf(const std::shared_ptr<T>& object)
+{
+    ExpiryDeleter<T>* deleter = std::get_deleter<ExpiryDeleter<T>>(object);
+    return deleter == nullptr ? nullptr : &deleter->observers;
+}
+
+
+namespace expiry_detail
+{
+    struct CallbackObserver : ExpiryObserver
+    {
+        void (*callback)(void*) = nullptr;
+        void* context = nullptr;
+    };
+}
+
+
+// Calls callback(context) once, right after the object is deleted (on whichever thread dropped the last shared_ptr).
+// Returns false if the object isn't observable.
+template<class T>
+bool onExpire(const std::shared_ptr<T>& object, void (*callback)(void*), void* context)
+{
+    ExpiryList* list = expiryListOf(object);
+    if (list == nullptr)
+    {
+        return false;
+    }
+    expiry_detail::CallbackObserver* observer = new expiry_detail::CallbackObserver();
+    observer->callback = callback;
+    observer->context = context;
+    observer->fire = [](ExpiryObserver* self)
+    {
+        expiry_detail::CallbackObserver* me = static_cast<expiry_detail::CallbackObserver*>(self);
+        me->callback(me->context);
+        delete me;
+    };
+    list->add(observer);
+    return true;
+}
+
+
+// Collects the keys of objects that died, for someone to drain later.
+// Expiring objects push onto it from any thread, lock free. drain() should only be called from one thread at a time.
+// The queue itself is shared with the entries waiting in it, so it's fine to destroy it before the objects it watches.
+template<class Key>
+class ExpiryQueue
+{
+public:
+    ExpiryQueue() : core(std::make_shared<Core>()) {}
+
+    ~ExpiryQueue()
+    {
+        drain([](const Key&) {});
+    }
+
+    ExpiryQueue(const ExpiryQueue&) = delete;
+    ExpiryQueue& operator=(const ExpiryQueue&) = delete;
+
+    // When object dies, key goes in the queue. Returns false if the object isn't observable.
+    template<class T>
+    bool watch(const std::shared_ptr<T>& object, Key key)
+    {
+        ExpiryList* list = expiryListOf(object);
+        if (list == nullptr)
+        {
+            return false;
+        }
+        Entry* entry = new Entry();
+        entry->key = std::move(key);
+        entry->core = core;
+        entry->fire = [](ExpiryObserver* self)
+        {
+            Entry* me = static_cast<Entry*>(self);
+            std::shared_ptr<Core> core = std::move(me->core);      // The object's list is done with this entry, so it can reuse next.
+            me->next = core->expired.load(std::memory_order_relaxed);
+            while (!core->expired.compare_exchange_weak(me->next, me, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        };
+        list->add(entry);
+        return true;
+    }
+
+    // Calls fn(key) for everything that died since the last drain. Returns how many there were.
+    template<class Fn>
+    std::size_t drain(Fn&& fn)
+    {
+        ExpiryObserver* entry = core->expired.exchange(nullptr, std::memory_order_acquire);
+
+        ExpiryObserver* oldestFirst = nullptr;     // The stack hands them back newest first, flip it around.
+        while (entry != nullptr)
+        {
+            ExpiryObserver* next = entry->next;
+            entry->next = oldestFirst;
+            oldestFirst = entry;
+            entry = next;
+        }
+
+        std::size_t count = 0;
+        while (oldestFirst != nullptr)
+        {
+            Entry* me = static_cast<Entry*>(oldestFirst);
+            oldestFirst = oldestFirst->next;
+            fn(me->key);
+            delete me;
+            count++;
+        }
+        return count;
+    }
+
+private:
+    struct Core
+    {
+        std::atomic<ExpiryObserver*> expired{ nullptr };
+
+        ~Core()
+        {
+            ExpiryObserver* entry = expired.load(std::memory_order_acquire);    // Anything that died after the queue was gone.
+            while (entry != nullptr)
+            {
+                ExpiryObserver* next = entry->next;
+                delete static_cast<Entry*>(entry);
+                entry = next;
+            }
+        }
+    };
+
+    struct Entry : ExpiryObserver
+    {
+        Key key;
+        std::shared_ptr<Core> core;
+    };
+
+    std::shared_ptr<Core> core;
+};
@@ -0,0 +1,140 @@
+/*
+Incremental Release
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// `delete buttercup` drops the last reference to the Professor, and the Professor drops the last reference to HIS parent,
+// and so on. With a big enough family that one line takes as long as it takes.
+//
+// An IncrementalReleaser turns that into small pieces. Like ParallelTeardown, the destructor hands its parent over
+// instead of letting go of it right there:
+//
+//     ~Person()
+//     {
+//         IncrementalReleaser::defer(std::move(parent));
+//     }
+//
+// While a releaser exists on this thread, defer() puts the parent on the releaser's list. Then:
+//
+//     releaser.pump(1000, 100);   // Destroy at most 1000 people, or for at most 100 microseconds.
+//
+// Call pump() once a frame (or whenever there's time) until pending() is 0.
+// Each destructor only ever adds its own parent, so the work for one pump is one destructor at a time, never a whole chain.
+//
+// With no releaser on the thread, defer() releases right away, same as before.
+// A releaser belongs to the thread that made it, only defer and pump from there.
+
+class IncrementalReleaser
+{
+public:
+    IncrementalReleaser() : previous(current())
+    {
+        current() = this;
+    }
+
+    ~IncrementalReleaser()
+    {
+        pump(0, 0);     // Whatever's left, all at once.
+        current() = previous;
+    }
+
+    IncrementalReleaser(const IncrementalReleaser&) = delete;
+    IncrementalReleaser& operator=(const IncrementalReleaser&) = delete;
+
+    // Hands a pointer to this thread's releaser, if there is one. (Called from destructors)
+    template<class T>
+    static void defer(std::shared_ptr<T>&& owner)
+    {
+        if (owner == nullptr)
+        {
+            return;
+        }
+
+        IncrementalReleaser* releaser = current();
+        if (releaser == nullptr)
+        {
+            owner.reset();
+            return;
+        }
+        releaser->work.push_back(std::shared_ptr<void>(std::move(owner)));
+    }
+
+    // Queues these to be released by pump(). Nothing is destroyed yet.
+    template<class T>
+    void release(std::shared_ptr<T>&& owner)
+    {
+        if (owner != nullptr)
+        {
+            work.push_back(std::shared_ptr<void>(std::move(owner)));
+        }
+    }
+
+    template<class T>
+    void release(std::vector<std::shared_ptr<T>>&& owners)
+    {
+        work.reserve(work.size() + owners.size());
+        for (std::shared_ptr<T>& owner : owners)
+        {
+            release(std::move(owner));
+        }
+        owners.clear();
+    }
+
+    // Releases queued pointers until `maxNodes` are done or `maxMicros` have passed (0 means no limit for either).
+    // The time is checked after every release, so a pump only goes over by the cost of one destructor.
+    // (make release-budget checks that)
+    // Returns how many were released.
+    std::size_t pump(std::size_t maxNodes, std::uint64_t maxMicros)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::microseconds budget(maxMicros);
+
+        std::size_t released = 0;
+        while (!work.empty() && (maxNodes == 0 || released < maxNodes))
+        {
+            // Taking it off the list before releasing it matters: the destructor this sets off will push onto the same list.
+            std::shared_ptr<void> owner = std::move(work.back());
+            work.pop_back();
+            owner.reset();
+            released++;
+
+            if (maxMicros != 0 && std::chrono::steady_clock::now() - start >= budget)
+            {
+                break;
+            }
+        }
+        return released;
+    }
+
+    std::size_t pending() const { return work.size(); }
+
+private:
+    std::vector<std::shared_ptr<void>> work;
+    IncrementalReleaser* previous;
+
+    static IncrementalReleaser*& current()
+    {
+        static thread_local IncrementalReleaser* releaser = nullptr;
+        return releaser;
+    }
+};
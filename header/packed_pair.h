@@ -0,0 +1,129 @@
+/*
+Packed Pointer Pairs
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "pointer_bits.h"
+
+// Pair<std::unique_ptr<A>, std::unique_ptr<B>> (from pair.h) is two pointers, 16 bytes.
+// If you also need a couple of small tags and flags for each pair, those go next to it, and padding rounds it up to 24.
+//
+// PackedPair stores all of that in the same 16 bytes, using the spare bits from pointer_bits.h:
+//
+//   each pointer's word:   [ 16 bit tag | 48 bit address | flags ... | owned ]
+//                             high bits                    low bits (alignment)
+//
+//   - owned: whether the pair deletes that pointer (like unique_ptr) or just points at it.
+//   - flags: whatever is left of the low bits, for you (2 bits each for 8-byte aligned types).
+//   - tag:   a 16 bit number, for you. (On 32 bit builds there are no spare high bits, tags are always 0 there)
+//
+// Like unique_ptr, a PackedPair can be moved but not copied, and deletes what it owns when it's destroyed.
+
+template<class A, class B>
+class PackedPair
+{
+    static_assert(pointer_bits::lowBits<A>() >= 1 && pointer_bits::lowBits<B>() >= 1, "PackedPair needs at least one free low bit per pointer");
+
+public:
+    static const unsigned FirstFlagBits = pointer_bits::lowBits<A>() - 1;
+    static const unsigned SecondFlagBits = pointer_bits::lowBits<B>() - 1;
+    static const unsigned TagBits = pointer_bits::HighBits;
+
+    PackedPair() = default;
+
+    PackedPair(std::unique_ptr<A> first, std::unique_ptr<B> second)
+        : firstWord(pointer_bits::pack(first.release(), Owned, 0)), secondWord(pointer_bits::pack(second.release(), Owned, 0)) {}
+
+    // Not owned, the pair will just point at these.
+    PackedPair(A* first, B* second)
+        : firstWord(pointer_bits::pack(first, 0, 0)), secondWord(pointer_bits::pack(second, 0, 0)) {}
+
+    PackedPair(PackedPair&& other) noexcept
+        : firstWord(std::exchange(other.firstWord, 0)), secondWord(std::exchange(other.secondWord, 0)) {}
+
+    PackedPair& operator=(PackedPair&& other) noexcept
+    {
+        std::uintptr_t takenFirst = std::exchange(other.firstWord, 0);     // Take them first: other might live inside something we're about to delete.
+        std::uintptr_t takenSecond = std::exchange(other.secondWord, 0);
+        destroy();
+        firstWord = takenFirst;
+        secondWord = takenSecond;
+        return *this;
+    }
+
+    PackedPair(const PackedPair&) = delete;
+    PackedPair& operator=(const PackedPair&) = delete;
+
+    ~PackedPair()
+    {
+        destroy();
+    }
+
+    A* first() const { return pointer_bits::pointer<A>(firstWord); }
+    B* second() const { return pointer_bits::pointer<B>(secondWord); }
+
+    bool ownsFirst() const { return (firstWord & Owned) != 0; }
+    bool ownsSecond() const { return (secondWord & Owned) != 0; }
+
+    std::uint16_t firstTag() const { return static_cast<std::uint16_t>(pointer_bits::high(firstWord)); }
+    std::uint16_t secondTag() const { return static_cast<std::uint16_t>(pointer_bits::high(secondWord)); }
+    void setFirstTag(std::uint16_t tag) { firstWord = pointer_bits::pack(first(), pointer_bits::low<A>(firstWord), tag); }
+    void setSecondTag(std::uint16_t tag) { secondWord = pointer_bits::pack(second(), pointer_bits::low<B>(secondWord), tag); }
+
+    unsigned firstFlags() const { return static_cast<unsigned>(pointer_bits::low<A>(firstWord) >> 1); }
+    unsigned secondFlags() const { return static_cast<unsigned>(pointer_bits::low<B>(secondWord) >> 1); }
+    void setFirstFlags(unsigned flags) { firstWord = pointer_bits::pack(first(), (flags << 1) | (firstWord & Owned), firstTag()); }
+    void setSecondFlags(unsigned flags) { secondWord = pointer_bits::pack(second(), (flags << 1) | (secondWord & Owned), secondTag()); }
+
+    // Hands back ownership (if we had it). The pointer, tag and flags stay, but the pair won't delete it anymore.
+    std::unique_ptr<A> releaseFirst()
+    {
+        bool owned = ownsFirst();
+        firstWord &= ~static_cast<std::uintptr_t>(Owned);
+        return std::unique_ptr<A>(owned ? first() : nullptr);
+    }
+
+    std::unique_ptr<B> releaseSecond()
+    {
+        bool owned = ownsSecond();
+        secondWord &= ~static_cast<std::uintptr_t>(Owned);
+        return std::unique_ptr<B>(owned ? second() : nullptr);
+    }
+
+private:
+    static const std::uintptr_t Owned = 1;
+
+    std::uintptr_t firstWord = 0;
+    std::uintptr_t secondWord = 0;
+
+    void destroy()
+    {
+        if (ownsFirst())
+        {
+            delete first();
+        }
+        if (ownsSecond())
+        {
+            delete second();
+        }
+        firstWord = 0;
+        secondWord = 0;
+    }
+};
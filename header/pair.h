@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <utility>
+
 // Creating a class template is simple-ish
 template<class TypeA, class TypeB>  // Start by declaring the template like this. We have a class here that has two templated types.
 class Pair                          // This example is a simple pair class that stores two objects together.
@@ -29,7 +31,7 @@ public:                             // The rest is simple, we define the class h
                                     // Note that we define the constructor here:
                                     // This is the most important part of class templates: EVERYTHING MUST BE DEFINED IN THE HEADER!!!
                                     // class templates don't have cpp files, because the code they have isn't "code" it's a template for code.
-    Pair(TypeA a, TypeB b) : first(a), second(b) {}
+    Pair(TypeA a, TypeB b) : first(std::move(a)), second(std::move(b)) {}    // (moving instead of copying lets this hold a unique_ptr too)
 
     TypeA first;
     TypeB second;
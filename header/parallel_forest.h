@@ -0,0 +1,103 @@
+/*
+Parallel Forest Construction
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "thread_pool.h"
+
+// In main.cpp we build Blossom, Bubbles, Buttercup and the Professor one at a time.
+// That's fine for four people, but building millions of them is worth spreading across threads.
+//
+// SharedForest builds the whole thing in two passes on a WorkStealingPool:
+//   1. Create every person. Each thread allocates from its own Arena (person and shared_ptr control block together),
+//      so the threads aren't all waiting in line inside malloc.
+//   2. Link every person to their parent. Parents are found by index, and are all created by now.
+//
+// The Person type just needs a constructor taking a std::string, and a std::shared_ptr<Person> named parent,
+// exactly like the shared_ptr Person in main.cpp.
+//
+// Since the people live in the forest's arenas, no shared_ptr to them may be kept after the forest is destroyed.
+
+template<class Person>
+class SharedForest
+{
+public:
+    static const std::size_t NoParent = static_cast<std::size_t>(-1);
+
+    // nameOf(i) gives the name of person i, parentOf(i) the index of their parent (or NoParent).
+    // Parents should come before their children (parentOf(i) < i), which keeps teardown shallow.
+    template<class NameOf, class ParentOf>
+    SharedForest(WorkStealingPool& pool, std::size_t count, NameOf nameOf, ParentOf parentOf, std::size_t grain = 4096)
+    {
+        for (unsigned i = 0; i <= pool.size(); i++)     // One extra arena, in case the calling thread ends up doing some work.
+        {
+            arenas.emplace_back(new Arena());
+        }
+
+        people.resize(count);
+
+        pool.parallelFor(0, count, grain, [&](std::size_t i)
+        {
+            Arena& arena = *arenas[pool.workerIndex()];
+            people[i] = std::allocate_shared<Person>(ArenaAllocator<Person>(arena), nameOf(i));
+        });
+
+        pool.parallelFor(0, count, grain, [&](std::size_t i)
+        {
+            std::size_t parent = parentOf(i);
+            if (parent != NoParent)
+            {
+                people[i]->parent = people[parent];
+            }
+        });
+    }
+
+    ~SharedForest()
+    {
+        // Let go of the newest people first. Their parents are still held by the vector at that point,
+        // so each release destroys exactly one person instead of setting off a long chain of destructors.
+        while (!people.empty())
+        {
+            people.pop_back();
+        }
+    }
+
+    SharedForest(const SharedForest&) = delete;
+    SharedForest& operator=(const SharedForest&) = delete;
+
+    std::size_t size() const { return people.size(); }
+    const std::shared_ptr<Person>& operator[](std::size_t i) const { return people[i]; }
+
+    std::size_t bytesReserved() const
+    {
+        std::size_t total = 0;
+        for (const std::unique_ptr<Arena>& arena : arenas)
+        {
+            total += arena->bytesReserved();
+        }
+        return total;
+    }
+
+private:
+    std::vector<std::unique_ptr<Arena>> arenas;         // Declared first so they're destroyed last, after every person is gone.
+    std::vector<std::shared_ptr<Person>> people;
+};
@@ -0,0 +1,146 @@
+/*
+Parallel Teardown
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+// When the last shared_ptr to a person goes away, their destructor releases their parent,
+// which may have been the last reference to the parent, whose destructor releases the grandparent, and so on.
+// For a huge forest that's millions of destructors in a row on one thread (and a very deep call stack).
+//
+// ParallelTeardown changes what "releasing the parent" means while it's running:
+// instead of letting go of the parent right there in the destructor, the destructor hands it over with
+//
+//     ~Person()
+//     {
+//         ParallelTeardown::defer(std::move(parent));
+//     }
+//
+// and the teardown lets go of it a moment later, from a work list. When a thread's work list gets long,
+// half of it is handed to another thread in the pool.
+//
+// The order within a chain doesn't change: a parent can't be destroyed while its child still holds it,
+// so the child's destructor always runs first. Separate chains are torn down at the same time on different threads.
+//
+// Outside of a teardown, defer() just releases the pointer right away, so the class behaves exactly as before.
+
+class ParallelTeardown
+{
+public:
+    // `batch` is how long a work list can get before half of it is given away.
+    explicit ParallelTeardown(WorkStealingPool& pool, std::size_t batch = 1024) : pool(pool), batch(batch) {}
+
+    // The pool's tasks point back at us, so they have to be done before we go.
+    ~ParallelTeardown()
+    {
+        wait();
+    }
+
+    ParallelTeardown(const ParallelTeardown&) = delete;
+    ParallelTeardown& operator=(const ParallelTeardown&) = delete;
+
+    // Hands a pointer over to the teardown.
+    // Called from destructors: it's a move, so the reference count isn't touched.
+    template<class T>
+    static void defer(std::shared_ptr<T>&& owner)
+    {
+        if (owner == nullptr)
+        {
+            return;
+        }
+
+        WorkList* list = current();
+        if (list == nullptr)
+        {
+            owner.reset();      // No teardown running on this thread, release it normally.
+            return;
+        }
+        list->push_back(std::shared_ptr<void>(std::move(owner)));
+    }
+
+    // Lets go of all these pointers, spreading the destructors they set off across the pool.
+    template<class T>
+    void release(std::vector<std::shared_ptr<T>>&& owners)
+    {
+        std::shared_ptr<WorkList> list = std::make_shared<WorkList>();
+        list->reserve(owners.size());
+        for (std::shared_ptr<T>& owner : owners)
+        {
+            list->push_back(std::shared_ptr<void>(std::move(owner)));
+        }
+        owners.clear();
+        pool.submit([this, list]() { run(std::move(*list)); });
+    }
+
+    template<class T>
+    void release(std::shared_ptr<T>&& owner)
+    {
+        std::vector<std::shared_ptr<T>> owners;
+        owners.push_back(std::move(owner));
+        release(std::move(owners));
+    }
+
+    // Waits until everything released so far has been destroyed.
+    void wait()
+    {
+        pool.wait();
+    }
+
+private:
+    typedef std::vector<std::shared_ptr<void>> WorkList;
+
+    WorkStealingPool& pool;
+    std::size_t batch;
+
+    static WorkList*& current()
+    {
+        static thread_local WorkList* list = nullptr;
+        return list;
+    }
+
+    void run(WorkList list)
+    {
+        WorkList* previous = current();
+        current() = &list;
+
+        while (!list.empty())
+        {
+            if (list.size() > batch)
+            {
+                // Give half to whoever wants it. Those are whole chains nobody here will touch again.
+                // The back half, so what stays doesn't have to be shifted down.
+                std::size_t keep = list.size() - list.size() / 2;
+                std::shared_ptr<WorkList> stolen = std::make_shared<WorkList>(
+                    std::make_move_iterator(list.begin() + keep), std::make_move_iterator(list.end()));
+                list.resize(keep);
+                pool.submit([this, stolen]() { run(std::move(*stolen)); });
+            }
+
+            // Taking it off the list before releasing it matters: the destructor this sets off will push onto the same list.
+            std::shared_ptr<void> owner = std::move(list.back());
+            list.pop_back();
+            owner.reset();
+        }
+
+        current() = previous;
+    }
+};
@@ -0,0 +1,270 @@
+/*
+Hardware Performance Counters
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Wall time tells you that copying a shared_ptr got slow, but not why.
+// The CPU keeps its own counters of what it was doing (cycles spent, instructions retired, cache misses...),
+// and on Linux we can read them with perf_event_open. This header wraps that up so any scenario can be measured like:
+//
+//     PerfCounters counters;
+//     PerfSample sample = counters.measure("shared_ptr copy", 1000000, [&]() { ... });
+//     std::cout << sample << std::endl;
+//
+// On other platforms (or when the kernel doesn't let us read the counters) everything still runs, we just report "n/a".
+
+// One result of a measured scenario.
+struct PerfSample
+{
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        CacheLineTransfers,     // Cache lines pulled out of another core's cache. This is what refcount contention looks like.
+        EventCount
+    };
+
+    std::string name;
+    std::uint64_t ops = 1;                      // How many operations the scenario did, so we can print per-op numbers.
+    double wallNanoseconds = 0;
+    double values[EventCount] = {};             // Raw totals for the whole scenario (scaled if the kernel had to multiplex, all by the same amount).
+    bool valid[EventCount] = {};                // false if that counter couldn't be opened.
+
+    double perOp(Event e) const
+    {
+        return values[e] / static_cast<double>(ops == 0 ? 1 : ops);
+    }
+
+    static const char* eventName(Event e)
+    {
+        static const char* names[EventCount] = { "cycles", "instructions", "cache-misses", "branch-misses", "xcore-transfers" };
+        return names[e];
+    }
+};
+
+
+class PerfCounters
+{
+public:
+    // There is no portable event for "cache line transferred from another core", every CPU family calls it something different.
+    // (On Intel it's a HITM event, e.g. MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM = raw 0x04d2 on Skylake)
+    // Pass the raw event code for your machine, or set SMARTPTR_XCORE_EVENT=0x04d2 in the environment. 0 means "don't count it".
+    explicit PerfCounters(std::uint64_t crossCoreRawEvent = environmentRawEvent())
+    {
+        for (int i = 0; i < PerfSample::EventCount; i++)
+        {
+            fds[i] = -1;
+        }
+
+#ifdef __linux__
+        // One group: the kernel then runs them all at the same time or none of them, so if it has to take turns
+        // (multiplex), cycles and instructions are still counted over the same stretch and their ratio means something.
+        open(PerfSample::Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(PerfSample::Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(PerfSample::CacheMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(PerfSample::BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        if (crossCoreRawEvent != 0)
+        {
+            open(PerfSample::CacheLineTransfers, PERF_TYPE_RAW, crossCoreRawEvent);
+        }
+#else
+        (void)crossCoreRawEvent;
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int i = 0; i < PerfSample::EventCount; i++)
+        {
+            if (fds[i] != -1)
+            {
+                close(fds[i]);
+            }
+        }
+#endif
+    }
+
+    // Counters are file descriptors, copying them around would just end up closing them twice.
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // true if at least one hardware counter is readable.
+    bool available() const
+    {
+        return leader != -1;
+    }
+
+    // Runs the scenario once with the counters enabled.
+    // Threads the scenario starts are counted too (the counters are inherited), so contention tests work as expected.
+    template<class Function>
+    PerfSample measure(const std::string& name, std::uint64_t ops, Function&& scenario)
+    {
+        PerfSample sample;
+        sample.name = name;
+        sample.ops = ops;
+
+        control(reset);
+        control(enable);
+        std::uint64_t begin = now();
+
+        scenario();
+
+        std::uint64_t end = now();
+        control(disable);
+
+        sample.wallNanoseconds = static_cast<double>(end - begin);
+        read(sample);
+        return sample;
+    }
+
+private:
+    int fds[PerfSample::EventCount];
+    int leader = -1;                            // The group's first counter. The group is started and read through it.
+    PerfSample::Event order[PerfSample::EventCount];    // Which counter is which in a group read.
+    int members = 0;
+
+    enum Command { reset, enable, disable };
+
+    static std::uint64_t environmentRawEvent()
+    {
+        const char* value = std::getenv("SMARTPTR_XCORE_EVENT");
+        return value == nullptr ? 0 : std::strtoull(value, nullptr, 0);
+    }
+
+#ifdef __linux__
+    // Adds a counter to the group (the first one that opens leads it). One the kernel won't take just stays "n/a".
+    void open(PerfSample::Event event, std::uint32_t type, std::uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = leader == -1 ? 1 : 0;   // Members follow the leader.
+        attr.inherit = 1;           // Follow threads created by the scenario.
+        attr.exclude_kernel = 1;    // We only care about our own code, and this works without root.
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        long fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd == -1)
+        {
+            return;
+        }
+        fds[event] = static_cast<int>(fd);
+        if (leader == -1)
+        {
+            leader = fds[event];
+        }
+        order[members++] = event;
+    }
+
+    void control(Command command)
+    {
+        static const unsigned long requests[] = { PERF_EVENT_IOC_RESET, PERF_EVENT_IOC_ENABLE, PERF_EVENT_IOC_DISABLE };
+        if (leader != -1)
+        {
+            ioctl(leader, requests[command], PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void read(PerfSample& sample) const
+    {
+        if (leader == -1)
+        {
+            return;
+        }
+
+        std::uint64_t data[3 + PerfSample::EventCount] = {};     // how many, time enabled, time running, then the values
+        ssize_t size = static_cast<ssize_t>((3 + members) * sizeof(std::uint64_t));
+        if (::read(leader, data, sizeof(data)) != size || data[0] != static_cast<std::uint64_t>(members) || data[2] == 0)
+        {
+            return;
+        }
+
+        // If there were more counters than hardware slots, the kernel took turns with them.
+        // Scale the counts up to estimate what they would have been if they ran the whole time.
+        for (int i = 0; i < members; i++)
+        {
+            sample.values[order[i]] = static_cast<double>(data[3 + i]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            sample.valid[order[i]] = true;
+        }
+    }
+
+    static std::uint64_t now()
+    {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(time.tv_nsec);
+    }
+#else
+    void control(Command) {}
+    void read(PerfSample&) const {}
+
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+#endif
+};
+
+
+// Prints one line per scenario, everything divided by the number of operations.
+inline std::ostream& operator<<(std::ostream& output, const PerfSample& sample)
+{
+    // Leave the stream printing numbers the way it did before.
+    std::ios_base::fmtflags flags = output.flags();
+    std::streamsize precision = output.precision();
+
+    output << sample.name << ": " << std::fixed << std::setprecision(2)
+           << sample.wallNanoseconds / static_cast<double>(sample.ops == 0 ? 1 : sample.ops) << " ns/op";
+
+    for (int i = 0; i < PerfSample::EventCount; i++)
+    {
+        PerfSample::Event e = static_cast<PerfSample::Event>(i);
+        output << ", " << PerfSample::eventName(e) << ": ";
+        if (sample.valid[i])
+        {
+            output << sample.perOp(e);
+        }
+        else
+        {
+            output << "n/a";
+        }
+    }
+    output.flags(flags);
+    output.precision(precision);
+    return output;
+}
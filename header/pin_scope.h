@@ -0,0 +1,150 @@
+/*
+Pin Scopes
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "borrowed_ptr.h"
+
+// Reading the parent's name for every child:
+//
+//     for (Person* child : children)
+//     {
+//         std::shared_ptr<Person> parent = child->parent;     // So it can't go away while we read. 2 atomic ops.
+//         total += parent->name.size();
+//     }
+//
+// Thousands of children, but only a handful of parents: almost all of those copies are of a pointer we just copied.
+// A PinScope keeps ONE reference to each object for the whole batch, and hands out borrowed_ptrs:
+//
+//     PinScope scope;
+//     for (Person* child : children)
+//     {
+//         borrowed_ptr<Person> parent = scope.pin(child->parent);    // Only counts if it's a different parent than last time.
+//         total += parent->name.size();
+//     }
+//     // Everything pinned is let go here.
+//
+// The borrows are good until the scope ends, no matter what happens to child->parent in the meantime.
+// pin() remembers what it pinned in a small table by address (RecentSlots entries, set up like a CPU cache),
+// so a batch that keeps coming back to a few hundred objects costs about one count per object, in any order.
+// When two objects land on the same entry, the newer one takes it, and the older one just gets counted again
+// if it comes back: more references than needed, never fewer.
+//
+// Debug builds (BORROWED_PTR_CHECKS, see borrowed_ptr.h) check the borrows: each one watches the scope,
+// and using one after the scope is gone aborts right there.
+
+class PinScope
+{
+public:
+    static constexpr std::size_t RecentSlots = 256;
+    static constexpr std::size_t Ways = 4;
+
+    PinScope()
+#if BORROWED_PTR_CHECKS
+        : token(std::make_shared<char>())
+#endif
+    {
+    }
+
+    PinScope(const PinScope&) = delete;
+    PinScope& operator=(const PinScope&) = delete;
+
+    // Keeps `owner`'s object alive until the scope ends.
+    template<class T>
+    borrowed_ptr<T> pin(const std::shared_ptr<T>& owner)
+    {
+        if (owner == nullptr)
+        {
+            return borrowed_ptr<T>();
+        }
+        if (!remember(owner.get()))
+        {
+            pinned.push_back(owner);
+        }
+        return borrow(owner.get());
+    }
+
+    // Same for a weak_ptr: an empty borrow if the object is already gone.
+    template<class T>
+    borrowed_ptr<T> pin(const std::weak_ptr<T>& weak)
+    {
+        return pin(weak.lock());
+    }
+
+    // How many references the scope is holding (how many times it actually counted).
+    std::size_t size() const { return pinned.size(); }
+
+    // For reusing a scope for the next batch: lets go of everything now. Earlier borrows are dead after this.
+    void clear()
+    {
+        pinned.clear();
+        std::fill(std::begin(recent), std::end(recent), nullptr);
+#if BORROWED_PTR_CHECKS
+        token = std::make_shared<char>();
+#endif
+    }
+
+private:
+    std::vector<std::shared_ptr<const void>> pinned;
+    const void* recent[RecentSlots] = {};     // Pinned objects, by address. (Only compared, never used to get at anything)
+
+#if BORROWED_PTR_CHECKS
+    std::shared_ptr<char> token;    // Borrows watch this instead of their object: it goes away with the scope.
+#endif
+
+    // Was `object` pinned already? If not, it goes in the table now.
+    // The table is in sets of Ways entries (like a CPU cache): an object can only be in its own set, newest first.
+    // Objects from the same allocator sit at regular distances, so the address is mixed up first (Fibonacci hashing)
+    // instead of just taking its low bits, which would put a lot of them in the same few sets.
+    bool remember(const void* object)
+    {
+        std::uint64_t address = reinterpret_cast<std::uintptr_t>(object);
+        const void** set = recent + ((address * 0x9E3779B97F4A7C15ull) >> 32) % (RecentSlots / Ways) * Ways;
+        bool found = false;
+        for (std::size_t way = 0; way < Ways; way++)
+        {
+            found |= set[way] == object;    // No early exit: which way it's in is random, and a branch on it would mispredict.
+        }
+        if (found)
+        {
+            return true;
+        }
+        for (std::size_t way = Ways - 1; way > 0; way--)
+        {
+            set[way] = set[way - 1];    // The oldest one falls out.
+        }
+        set[0] = object;
+        return false;
+    }
+
+    template<class T>
+    borrowed_ptr<T> borrow(T* object) const
+    {
+#if BORROWED_PTR_CHECKS
+        std::shared_ptr<T> watchScope(token, object);     // Aliasing: points at the object, but shares the token's count.
+        return borrowed_ptr<T>(watchScope);
+#else
+        return borrowed_ptr<T>(*object);
+#endif
+    }
+};
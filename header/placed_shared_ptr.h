@@ -0,0 +1,180 @@
+/*
+Control Block Placement
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+// A shared_ptr keeps its reference count in a "control block".
+// std::make_shared puts the control block right in front of the object, in the same allocation.
+// That's usually great (one allocation instead of two), but it means the count and the first few members of the object
+// (like a Person's name) share a 64 byte cache line. Now a thread writing the name and a thread copying the pointer
+// are fighting over the same cache line even though they never touch the same data. That's called false sharing.
+//
+// PlacedSharedPtr lets you pick where the control block goes:
+//   CoLocated  right in front of the object, like make_shared.
+//   Padded     same allocation, but the count gets a cache line all to itself.
+//   Separate   its own allocation, like shared_ptr<T>(new T).
+//
+//     PlacedSharedPtr<Person> professor = makePlaced<Person, ControlBlockPlacement::Padded>("Professor");
+//
+// (It only does strong references, no weak_ptr.)
+
+enum class ControlBlockPlacement
+{
+    CoLocated,
+    Padded,
+    Separate
+};
+
+const std::size_t CacheLineSize = 64;
+
+
+namespace placed_detail
+{
+    struct ControlBlock
+    {
+        std::atomic<long> count{ 1 };
+        void (*destroy)(ControlBlock*) = nullptr;  // Knows how this block (and its object) were allocated...
+        void* allocation = nullptr;                 // ...and this is what it needs to delete.
+    };
+
+    template<class T>
+    struct CoLocated
+    {
+        ControlBlock block;
+        T value;
+
+        template<class... Args>
+        explicit CoLocated(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+
+    template<class T>
+    struct Padded
+    {
+        alignas(CacheLineSize) ControlBlock block;
+        alignas(CacheLineSize) T value;             // Starts on the next cache line.
+
+        template<class... Args>
+        explicit Padded(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+}
+
+
+template<class T>
+class PlacedSharedPtr
+{
+public:
+    PlacedSharedPtr() = default;
+    PlacedSharedPtr(std::nullptr_t) {}
+
+    PlacedSharedPtr(const PlacedSharedPtr& other) : object(other.object), block(other.block)
+    {
+        if (block != nullptr)
+        {
+            block->count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PlacedSharedPtr(PlacedSharedPtr&& other) noexcept : object(other.object), block(other.block)
+    {
+        other.object = nullptr;
+        other.block = nullptr;
+    }
+
+    PlacedSharedPtr& operator=(PlacedSharedPtr other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~PlacedSharedPtr()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (block != nullptr && block->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            block->destroy(block);
+        }
+        object = nullptr;
+        block = nullptr;
+    }
+
+    void swap(PlacedSharedPtr& other) noexcept
+    {
+        std::swap(object, other.object);
+        std::swap(block, other.block);
+    }
+
+    T* get() const { return object; }
+    T& operator*() const { return *object; }
+    T* operator->() const { return object; }
+    explicit operator bool() const { return object != nullptr; }
+    long use_count() const { return block == nullptr ? 0 : block->count.load(std::memory_order_relaxed); }
+
+    // Where the count lives, so you can check which cache line it's on.
+    const void* controlBlock() const { return block; }
+
+private:
+    template<class U, ControlBlockPlacement Placement, class... Args>
+    friend PlacedSharedPtr<U> makePlaced(Args&&... args);
+
+    T* object = nullptr;
+    placed_detail::ControlBlock* block = nullptr;
+
+    PlacedSharedPtr(T* object, placed_detail::ControlBlock* block) : object(object), block(block) {}
+};
+
+
+template<class T, ControlBlockPlacement Placement = ControlBlockPlacement::CoLocated, class... Args>
+PlacedSharedPtr<T> makePlaced(Args&&... args)
+{
+    using namespace placed_detail;
+
+    if constexpr (Placement == ControlBlockPlacement::CoLocated)
+    {
+        CoLocated<T>* both = new CoLocated<T>(std::forward<Args>(args)...);
+        both->block.allocation = both;
+        both->block.destroy = [](ControlBlock* block) { delete static_cast<CoLocated<T>*>(block->allocation); };
+        return PlacedSharedPtr<T>(&both->value, &both->block);
+    }
+    else if constexpr (Placement == ControlBlockPlacement::Padded)
+    {
+        Padded<T>* both = new Padded<T>(std::forward<Args>(args)...);      // C++17 new respects the alignas.
+        both->block.allocation = both;
+        both->block.destroy = [](ControlBlock* block) { delete static_cast<Padded<T>*>(block->allocation); };
+        return PlacedSharedPtr<T>(&both->value, &both->block);
+    }
+    else
+    {
+        std::unique_ptr<T> value(new T(std::forward<Args>(args)...));     // Deleted again if the block can't be allocated, like shared_ptr<T>(new T).
+        ControlBlock* block = new ControlBlock();
+        block->allocation = value.get();
+        block->destroy = [](ControlBlock* block)
+        {
+            delete static_cast<T*>(block->allocation);
+            delete block;
+        };
+        return PlacedSharedPtr<T>(value.release(), block);
+    }
+}
@@ -0,0 +1,94 @@
+/*
+Spare Pointer Bits
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// A pointer is 64 bits, but not all of those bits are really used:
+//
+//   - LOW bits: an object with alignof 8 always lives at an address that's a multiple of 8,
+//     so the bottom 3 bits of a pointer to it are always 0. We can keep our own data in them.
+//   - HIGH bits: x86-64 and ARM64 programs only use 48 bit addresses (with 4-level page tables, which is what you get unless
+//     you ask the OS otherwise), so the top 16 bits of a user space pointer are 0 as well.
+//
+// These helpers pack small values into those bits and take them back out. You MUST strip them off again
+// before using the pointer (pointer() does that), the CPU would fault on an address with the high bits set.
+
+namespace pointer_bits
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__) || defined(_M_ARM64)
+    const unsigned HighBits = 16;
+#else
+    const unsigned HighBits = 0;        // 32 bit (or unknown) platforms: every high bit is a real address bit.
+#endif
+    const unsigned AddressBits = 64 - HighBits;
+    const unsigned HighShift = HighBits == 0 ? 0 : AddressBits;     // Where the high bits start (0 keeps the shifts legal on 32 bit).
+
+    // How many low bits are free in a pointer to T: log2(alignof(T)).
+    template<class T>
+    constexpr unsigned lowBits()
+    {
+        return alignof(T) >= 16 ? 4 : alignof(T) >= 8 ? 3 : alignof(T) >= 4 ? 2 : alignof(T) >= 2 ? 1 : 0;
+    }
+
+    template<class T>
+    constexpr std::uintptr_t lowMask()
+    {
+        return (static_cast<std::uintptr_t>(1) << lowBits<T>()) - 1;
+    }
+
+    constexpr std::uintptr_t highMask()
+    {
+        return HighBits == 0 ? 0 : ~((static_cast<std::uintptr_t>(1) << HighShift) - 1);
+    }
+
+    template<class T>
+    std::uintptr_t addressMask()
+    {
+        return ~(lowMask<T>() | highMask());
+    }
+
+    template<class T>
+    T* pointer(std::uintptr_t word)
+    {
+        return reinterpret_cast<T*>(word & addressMask<T>());
+    }
+
+    template<class T>
+    std::uintptr_t low(std::uintptr_t word)
+    {
+        return word & lowMask<T>();
+    }
+
+    inline std::uintptr_t high(std::uintptr_t word)
+    {
+        return HighBits == 0 ? 0 : (word & highMask()) >> HighShift;
+    }
+
+    // Builds a word out of a pointer and the values for its spare bits (values that don't fit are cut off).
+    template<class T>
+    std::uintptr_t pack(const T* object, std::uintptr_t lowValue, std::uintptr_t highValue)
+    {
+        std::uintptr_t word = reinterpret_cast<std::uintptr_t>(object) & addressMask<T>();
+        word |= lowValue & lowMask<T>();
+        if (HighBits != 0)
+        {
+            word |= (highValue << HighShift) & highMask();
+        }
+        return word;
+    }
+}
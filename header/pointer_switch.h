@@ -0,0 +1,92 @@
+/*
+Smart Pointer Switch
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "tuned_ptr.h"
+
+// Code written against sp:: can be built with either the std pointers or the ones from tuned_ptr.h:
+//
+//     sp::shared_ptr<Person> professor = sp::make_shared<Person>("Professor");
+//     sp::weak_ptr<Person> weakPtr = professor;
+//
+// By default sp:: is the tuned version (with SMARTPTR_POLICY, DefaultRefCountPolicy unless you say otherwise).
+// Compile with SMARTPTR_USE_STD=1 (make STD=1) and it's std:: instead, nothing else changes.
+// The benchmarks' matrix/sp/ scenarios use it, so a baseline saved from one build can be checked against the other:
+//
+//     make baseline STD=1 BUILD=build-std BASELINE=std.txt
+//     make check BASELINE=std.txt
+//
+// StdPointers and TunedPointers<Policy> are the same switch as types, for code that wants to compare several at once
+// (the fuzzer and the benchmarks do).
+
+struct StdPointers
+{
+    template<class T> using Unique = std::unique_ptr<T>;
+    template<class T> using Shared = std::shared_ptr<T>;
+    template<class T> using Weak = std::weak_ptr<T>;
+
+    template<class T, class... Args>
+    static Unique<T> makeUnique(Args&&... args) { return std::make_unique<T>(std::forward<Args>(args)...); }
+
+    template<class T, class... Args>
+    static Shared<T> makeShared(Args&&... args) { return std::make_shared<T>(std::forward<Args>(args)...); }
+};
+
+template<class Policy = DefaultRefCountPolicy>
+struct TunedPointers
+{
+    template<class T> using Unique = TunedUniquePtr<T>;
+    template<class T> using Shared = TunedSharedPtr<T, Policy>;
+    template<class T> using Weak = TunedWeakPtr<T, Policy>;
+
+    template<class T, class... Args>
+    static Unique<T> makeUnique(Args&&... args) { return makeTunedUnique<T>(std::forward<Args>(args)...); }
+
+    template<class T, class... Args>
+    static Shared<T> makeShared(Args&&... args) { return makeTunedShared<T, Policy>(std::forward<Args>(args)...); }
+};
+
+
+#ifndef SMARTPTR_USE_STD
+#define SMARTPTR_USE_STD 0
+#endif
+
+#ifndef SMARTPTR_POLICY
+#define SMARTPTR_POLICY DefaultRefCountPolicy
+#endif
+
+namespace sp
+{
+#if SMARTPTR_USE_STD
+    typedef StdPointers Selected;
+#else
+    typedef TunedPointers<SMARTPTR_POLICY> Selected;
+#endif
+
+    template<class T> using unique_ptr = typename Selected::template Unique<T>;
+    template<class T> using shared_ptr = typename Selected::template Shared<T>;
+    template<class T> using weak_ptr = typename Selected::template Weak<T>;
+
+    template<class T, class... Args>
+    unique_ptr<T> make_unique(Args&&... args) { return Selected::template makeUnique<T>(std::forward<Args>(args)...); }
+
+    template<class T, class... Args>
+    shared_ptr<T> make_shared(Args&&... args) { return Selected::template makeShared<T>(std::forward<Args>(args)...); }
+}
@@ -0,0 +1,728 @@
+/*
+Remote Reference Counting
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifdef _WIN32
+#error "header/remote_ptr.h needs Unix domain sockets"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Sometimes the Professor belongs to another process: it made him, it decides when he's destroyed, and everyone else
+// only holds references to him through it. The owner has to know about every reference, so the obvious way is a message
+// for every copy ("one more") and every destruction ("one less"). That's a round trip to another process per copy.
+//
+// Two things make it cheap:
+//
+// Weighted reference counting (Bevan, Watson and Watson, 1987). The owner doesn't count references, it hands out WEIGHT,
+// and remembers how much is out there. A RemotePtr carries some of it. Copying one splits its weight in half between
+// the two copies: the total doesn't change, so the owner doesn't need to hear about it. Destroying one gives its weight back.
+// The object is destroyed when all the weight has come back (and the owner itself let go).
+// Only a pointer down to a weight of 1 can't be split, it gets more from its client (which asks the owner now and then).
+//
+//     RemoteClient client("/tmp/people.sock");
+//     RemotePtr<Person> professor = client.acquire<Person>(professorId);    // A round trip.
+//     RemotePtr<Person> copy = professor;                                   // No message at all.
+//
+// Batching. Weight given back isn't sent right away: the client collects it and sends it in one message now and then
+// (every FlushAfter destroyed pointers, or on flush()). Spare weight the client got for topping up goes back with it.
+// So an object can outlive its last RemotePtr until the next flush.
+//
+// Leases. A client that crashes can't give its weight back. The owner keeps track of how much each client holds,
+// and each client has a lease: every message renews it, and a client that's been quiet for longer than the lease
+// is considered dead. Its weight is taken back, and its connection closed (the client finds out the next time it
+// sends something: leaseLost(), and acquire() throws). A busy client renews just by flushing.
+// One that holds pointers but isn't doing anything has to call keepAlive() more often than every leaseLength()/2.
+// (On the same host, a closed connection also means the client is gone, and the owner takes the weight back right away)
+//
+// The data itself stays with the owner. A RemotePtr only keeps the object alive: ask the owner for what you need by remoteId().
+// One client per thread: the client and its RemotePtrs aren't thread safe (no atomics, that's part of the point).
+// The client has to outlive its pointers: they give their weight back through it. Debug builds assert on a client
+// destroyed while some are still around.
+//
+// NaiveRemotePtr is the obvious way, for comparison: a round trip per copy, a message per destruction.
+
+template<class T>
+class RemotePtr;
+template<class T>
+class NaiveRemotePtr;
+
+namespace remote_detail
+{
+    enum class Op : std::uint32_t
+    {
+        Hello,      // Client -> owner. Reply: `value` is the lease, in milliseconds.
+        Acquire,    // Client -> owner, {id, weight wanted} per entry. Reply: {id, weight granted (0 if it's gone)}.
+        Release,    // Client -> owner, {id, weight given back} per entry. No reply.
+        Renew,      // Client -> owner. No reply: every message renews the lease, this one just doesn't do anything else.
+    };
+
+    const std::size_t MaxEntries = 64;
+    const std::uint64_t PointerGrant = static_cast<std::uint64_t>(1) << 32;    // What a pointer gets when it runs out.
+    const std::uint64_t ClientGrant = static_cast<std::uint64_t>(1) << 40;     // What a client asks the owner for at once.
+
+    struct Entry
+    {
+        std::uint64_t id;
+        std::uint64_t weight;
+    };
+
+    struct Message
+    {
+        Op op;
+        std::uint32_t count;
+        std::uint64_t value;
+        Entry entries[MaxEntries];
+
+        std::size_t size() const { return offsetof(Message, entries) + count * sizeof(Entry); }
+    };
+
+    // SOCK_SEQPACKET keeps messages whole, so one recv is one message.
+    inline bool send(int socket, const Message& message)
+    {
+        return ::send(socket, &message, message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size());
+    }
+
+    inline bool receive(int socket, Message& message)
+    {
+        ssize_t received = recv(socket, &message, sizeof(message), 0);
+        return received >= static_cast<ssize_t>(offsetof(Message, entries))
+            && static_cast<std::size_t>(received) == message.size();
+    }
+
+    inline sockaddr_un address(const std::string& path)
+    {
+        sockaddr_un result = {};
+        result.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(result.sun_path))
+        {
+            throw std::runtime_error("socket path too long: " + path);
+        }
+        std::memcpy(result.sun_path, path.c_str(), path.size() + 1);
+        return result;
+    }
+}
+
+
+// The process that owns the objects. Serves its clients on a Unix socket, from its own thread.
+class RemoteOwner
+{
+public:
+    struct Stats
+    {
+        std::uint64_t messages = 0;     // Received.
+        std::uint64_t expired = 0;      // Clients whose lease ran out.
+        std::uint64_t disconnected = 0; // Clients that closed their connection (exited or crashed) holding weight.
+    };
+
+    RemoteOwner(const std::string& path, std::chrono::milliseconds lease = std::chrono::milliseconds(2000))
+        : path(path), lease(lease)
+    {
+        sockaddr_un where = remote_detail::address(path);
+        listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (listener < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "socket");
+        }
+        unlink(path.c_str());
+        if (bind(listener, reinterpret_cast<sockaddr*>(&where), sizeof(where)) != 0 || listen(listener, 64) != 0)
+        {
+            int error = errno;
+            close(listener);
+            throw std::system_error(error, std::generic_category(), "bind " + path);
+        }
+        server = std::thread([this] { serve(); });
+    }
+
+    ~RemoteOwner()
+    {
+        stopping = true;
+        server.join();
+        for (Client& client : clients)
+        {
+            close(client.socket);
+        }
+        close(listener);
+        unlink(path.c_str());
+    }
+
+    RemoteOwner(const RemoteOwner&) = delete;
+    RemoteOwner& operator=(const RemoteOwner&) = delete;
+
+    // Makes `object` available to clients, by the id this returns. The owner holds on to it until unpublish().
+    template<class T>
+    std::uint64_t publish(std::shared_ptr<T> object)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::uint64_t id = nextId++;
+        objects[id].value = std::move(object);
+        return id;
+    }
+
+    // The owner lets go. The object is destroyed once the clients have given all their weight back.
+    void unpublish(std::uint64_t id)
+    {
+        std::shared_ptr<void> last;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = objects.find(id);
+            if (found == objects.end())
+            {
+                return;
+            }
+            found->second.published = false;
+            last = collect(found);
+        }
+        // `last` goes here, outside the lock: the destructor might be slow, or publish something itself.
+    }
+
+    // The object behind an id, for the owner to use. nullptr once it's gone.
+    template<class T>
+    std::shared_ptr<T> find(std::uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = objects.find(id);
+        return found == objects.end() ? nullptr : std::static_pointer_cast<T>(found->second.value);
+    }
+
+    std::size_t liveObjects()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return objects.size();
+    }
+
+    Stats statistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Object
+    {
+        std::shared_ptr<void> value;
+        std::uint64_t outstanding = 0;      // Weight the clients hold, all together.
+        bool published = true;
+    };
+
+    struct Client
+    {
+        int socket;
+        Clock::time_point deadline;
+        std::unordered_map<std::uint64_t, std::uint64_t> holds;    // Weight per object.
+    };
+
+    std::string path;
+    std::chrono::milliseconds lease;
+    int listener = -1;
+    std::thread server;
+    std::atomic<bool> stopping{ false };
+
+    std::mutex mutex;       // For objects and stats. (clients is only used by the server thread)
+    std::unordered_map<std::uint64_t, Object> objects;
+    std::uint64_t nextId = 1;
+    std::vector<Client> clients;
+    Stats stats;
+
+    // Takes the object out if nobody holds it any more. The caller lets go of what this returns, after unlocking.
+    std::shared_ptr<void> collect(std::unordered_map<std::uint64_t, Object>::iterator found)
+    {
+        if (found->second.published || found->second.outstanding != 0)
+        {
+            return nullptr;
+        }
+        std::shared_ptr<void> last = std::move(found->second.value);
+        objects.erase(found);
+        return last;
+    }
+
+    // Client gives weight back. More than it holds (a confused client) only takes back what it holds.
+    std::shared_ptr<void> release(Client& client, std::uint64_t id, std::uint64_t weight)
+    {
+        auto held = client.holds.find(id);
+        if (held == client.holds.end())
+        {
+            return nullptr;
+        }
+        weight = std::min(weight, held->second);
+        if ((held->second -= weight) == 0)
+        {
+            client.holds.erase(held);
+        }
+        auto found = objects.find(id);
+        found->second.outstanding -= weight;
+        return collect(found);
+    }
+
+    void serve()
+    {
+        std::vector<pollfd> waiting;
+        std::vector<std::shared_ptr<void>> destroyed;
+        while (!stopping)
+        {
+            waiting.assign(1, pollfd{ listener, POLLIN, 0 });
+            for (const Client& client : clients)
+            {
+                waiting.push_back(pollfd{ client.socket, POLLIN, 0 });
+            }
+            poll(waiting.data(), waiting.size(), 10);     // Wakes up now and then to check for expired leases and stopping.
+
+            std::unique_lock<std::mutex> lock(mutex);
+            Clock::time_point now = Clock::now();
+            if (waiting[0].revents & POLLIN)
+            {
+                int accepted = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if (accepted >= 0)
+                {
+                    clients.push_back(Client{ accepted, now + lease, {} });
+                }
+            }
+
+            // Backwards, so dropping a client doesn't move the ones still to do. (New ones are at the end, not polled yet)
+            for (std::size_t i = waiting.size() - 1; i > 0; i--)
+            {
+                Client& client = clients[i - 1];
+                if (waiting[i].revents == 0)
+                {
+                    if (client.deadline < now)
+                    {
+                        stats.expired++;
+                        drop(i - 1, destroyed);
+                    }
+                    continue;
+                }
+                remote_detail::Message message;
+                if (!remote_detail::receive(client.socket, message))
+                {
+                    stats.disconnected += client.holds.empty() ? 0 : 1;
+                    drop(i - 1, destroyed);
+                    continue;
+                }
+                stats.messages++;
+                client.deadline = now + lease;
+                handle(client, message, destroyed);
+            }
+
+            lock.unlock();
+            destroyed.clear();      // Destructors outside the lock.
+        }
+    }
+
+    void handle(Client& client, remote_detail::Message& message, std::vector<std::shared_ptr<void>>& destroyed)
+    {
+        switch (message.op)
+        {
+        case remote_detail::Op::Hello:
+            message.count = 0;
+            message.value = static_cast<std::uint64_t>(lease.count());
+            remote_detail::send(client.socket, message);
+            break;
+        case remote_detail::Op::Acquire:
+            for (std::uint32_t e = 0; e < message.count; e++)
+            {
+                remote_detail::Entry& entry = message.entries[e];
+                auto found = objects.find(entry.id);
+                if (found == objects.end())
+                {
+                    entry.weight = 0;
+                    continue;
+                }
+                found->second.outstanding += entry.weight;
+                client.holds[entry.id] += entry.weight;
+            }
+            remote_detail::send(client.socket, message);
+            break;
+        case remote_detail::Op::Release:
+            for (std::uint32_t e = 0; e < message.count; e++)
+            {
+                destroyed.push_back(release(client, message.entries[e].id, message.entries[e].weight));
+            }
+            break;
+        case remote_detail::Op::Renew:
+            break;
+        }
+    }
+
+    // The client is gone (or as good as): takes back all its weight, and hangs up on it.
+    void drop(std::size_t index, std::vector<std::shared_ptr<void>>& destroyed)
+    {
+        Client& client = clients[index];
+        while (!client.holds.empty())
+        {
+            auto held = client.holds.begin();
+            destroyed.push_back(release(client, held->first, held->second));
+        }
+        close(client.socket);
+        clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+};
+
+
+// One process's (one thread's) connection to an owner.
+class RemoteClient
+{
+public:
+    static const std::size_t FlushAfter = 256;      // Destroyed pointers to collect before giving the weight back.
+
+    struct Stats
+    {
+        std::uint64_t messages = 0;     // Sent.
+        std::uint64_t roundTrips = 0;   // Of those, how many waited for an answer.
+    };
+
+    explicit RemoteClient(const std::string& path)
+    {
+        sockaddr_un where = remote_detail::address(path);
+        connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (connection < 0 || connect(connection, reinterpret_cast<sockaddr*>(&where), sizeof(where)) != 0)
+        {
+            int error = errno;
+            if (connection >= 0)
+            {
+                close(connection);
+            }
+            throw std::system_error(error, std::generic_category(), "connect " + path);
+        }
+        remote_detail::Message message;
+        message.op = remote_detail::Op::Hello;
+        message.count = 0;
+        exchange(message);
+        lease = std::chrono::milliseconds(message.value);
+    }
+
+    // Gives everything back. Every pointer from this client has to be gone by now: a destroyed pointer tells its client,
+    // and this one won't be there to hear it.
+    ~RemoteClient()
+    {
+        assert(live == 0 && "RemoteClient destroyed while pointers from it are still around");
+        flush();
+        close(connection);
+    }
+
+    RemoteClient(const RemoteClient&) = delete;
+    RemoteClient& operator=(const RemoteClient&) = delete;
+
+    // A new reference to the owner's object `id`. Null if it doesn't exist (any more).
+    template<class T>
+    RemotePtr<T> acquire(std::uint64_t id)
+    {
+        std::uint64_t weight = topUp(id);
+        return weight == 0 ? RemotePtr<T>() : RemotePtr<T>(this, id, weight);
+    }
+
+    template<class T>
+    NaiveRemotePtr<T> acquireNaive(std::uint64_t id)
+    {
+        return requestWeight(id, 1) == 0 ? NaiveRemotePtr<T>() : NaiveRemotePtr<T>(this, id);
+    }
+
+    // Sends the weight collected from destroyed pointers, and the spare weight, back to the owner. Renews the lease.
+    void flush()
+    {
+        if (lost)
+        {
+            pending.clear();
+            spare.clear();
+            return;
+        }
+        for (const auto& weight : spare)
+        {
+            pending.push_back(remote_detail::Entry{ weight.first, weight.second });
+        }
+        spare.clear();
+        if (pending.empty())
+        {
+            keepAlive();
+            return;
+        }
+
+        // Lots of destroyed copies of a few objects: add them up per object first.
+        std::sort(pending.begin(), pending.end(), [](const remote_detail::Entry& a, const remote_detail::Entry& b) { return a.id < b.id; });
+        remote_detail::Message message;
+        message.op = remote_detail::Op::Release;
+        message.count = 0;
+        for (std::size_t i = 0; i < pending.size(); i++)
+        {
+            if (message.count > 0 && message.entries[message.count - 1].id == pending[i].id)
+            {
+                message.entries[message.count - 1].weight += pending[i].weight;
+                continue;
+            }
+            if (message.count == remote_detail::MaxEntries)
+            {
+                post(message);
+                message.count = 0;
+            }
+            message.entries[message.count++] = pending[i];
+        }
+        post(message);
+        pending.clear();
+    }
+
+    // Renews the lease if it's getting old. Call this regularly while holding pointers and otherwise doing nothing.
+    void keepAlive()
+    {
+        if (!lost && Clock::now() - lastSent > lease / 3)
+        {
+            remote_detail::Message message;
+            message.op = remote_detail::Op::Renew;
+            message.count = 0;
+            post(message);
+        }
+    }
+
+    // True once the owner has hung up on us (our lease ran out, or it went away): our pointers don't keep anything alive now.
+    bool leaseLost() const { return lost; }
+
+    std::chrono::milliseconds leaseLength() const { return lease; }
+
+    const Stats& statistics() const { return stats; }
+    void resetStatistics() { stats = Stats(); }
+
+private:
+    template<class T>
+    friend class RemotePtr;
+    template<class T>
+    friend class NaiveRemotePtr;
+
+    typedef std::chrono::steady_clock Clock;
+
+    int connection = -1;
+    std::chrono::milliseconds lease{ 0 };
+    Clock::time_point lastSent = Clock::now();
+    bool lost = false;
+    std::size_t live = 0;                                       // RemotePtrs and NaiveRemotePtrs from this client.
+    std::vector<remote_detail::Entry> pending;                  // Weight from destroyed pointers, not sent yet.
+    std::unordered_map<std::uint64_t, std::uint64_t> spare;     // Weight we got from the owner and haven't handed out.
+    Stats stats;
+
+    // Weight for a pointer that's run out (or a new one). From the spare weight if there is some, or else from the owner.
+    std::uint64_t topUp(std::uint64_t id)
+    {
+        std::uint64_t& available = spare[id];
+        if (available < remote_detail::PointerGrant)
+        {
+            available += requestWeight(id, remote_detail::ClientGrant);
+            if (available == 0)
+            {
+                spare.erase(id);
+                return 0;
+            }
+        }
+        std::uint64_t weight = std::min(available, remote_detail::PointerGrant);
+        available -= weight;
+        return weight;
+    }
+
+    void giveBack(std::uint64_t id, std::uint64_t weight)
+    {
+        pending.push_back(remote_detail::Entry{ id, weight });
+        if (pending.size() >= FlushAfter)
+        {
+            flush();
+        }
+    }
+
+    std::uint64_t requestWeight(std::uint64_t id, std::uint64_t weight)
+    {
+        remote_detail::Message message;
+        message.op = remote_detail::Op::Acquire;
+        message.count = 1;
+        message.entries[0] = remote_detail::Entry{ id, weight };
+        exchange(message);
+        return message.entries[0].weight;
+    }
+
+    // Right away, one message. (For NaiveRemotePtr)
+    void releaseNow(std::uint64_t id, std::uint64_t weight)
+    {
+        remote_detail::Message message;
+        message.op = remote_detail::Op::Release;
+        message.count = 1;
+        message.entries[0] = remote_detail::Entry{ id, weight };
+        post(message);
+    }
+
+    // Sends without waiting for an answer. Failing means the owner hung up, there's nobody to tell.
+    void post(const remote_detail::Message& message)
+    {
+        if (lost)
+        {
+            return;
+        }
+        stats.messages++;
+        lastSent = Clock::now();
+        lost = !remote_detail::send(connection, message);
+    }
+
+    // Sends and waits for the answer, which replaces `message`.
+    void exchange(remote_detail::Message& message)
+    {
+        post(message);
+        stats.roundTrips++;
+        if (lost || !remote_detail::receive(connection, message))
+        {
+            lost = true;
+            throw std::runtime_error("the owner hung up (our lease ran out, or it's gone)");
+        }
+    }
+};
+
+
+// A reference to an object another process owns. Copies are free: they split this pointer's weight.
+template<class T>
+class RemotePtr
+{
+public:
+    RemotePtr() = default;
+
+    RemotePtr(const RemotePtr& other) : client(other.client), id(other.id)
+    {
+        if (client != nullptr)
+        {
+            if (other.weight == 1)
+            {
+                other.weight += client->topUp(id);  // The only time a copy costs anything, and usually still not a message.
+            }
+            weight = other.weight / 2;
+            other.weight -= weight;
+            client->live++;
+        }
+    }
+
+    RemotePtr(RemotePtr&& other) noexcept
+        : client(std::exchange(other.client, nullptr)), id(other.id), weight(std::exchange(other.weight, 0))
+    {
+    }
+
+    RemotePtr& operator=(RemotePtr other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~RemotePtr()
+    {
+        if (client != nullptr)
+        {
+            client->live--;
+            client->giveBack(id, weight);
+        }
+    }
+
+    void reset()
+    {
+        RemotePtr().swap(*this);
+    }
+
+    void swap(RemotePtr& other) noexcept
+    {
+        std::swap(client, other.client);
+        std::swap(id, other.id);
+        std::swap(weight, other.weight);
+    }
+
+    // Which object, to ask the owner about it.
+    std::uint64_t remoteId() const { return id; }
+    explicit operator bool() const { return client != nullptr; }
+    bool operator==(std::nullptr_t) const { return client == nullptr; }
+
+private:
+    friend class RemoteClient;
+
+    RemoteClient* client = nullptr;
+    std::uint64_t id = 0;
+    mutable std::uint64_t weight = 0;   // Copying changes it, but not what the pointer means, so copying from a const one is fine.
+
+    RemotePtr(RemoteClient* client, std::uint64_t id, std::uint64_t weight) : client(client), id(id), weight(weight)
+    {
+        client->live++;
+    }
+};
+
+
+// The same, counted the obvious way: the owner hears about every copy and every destruction.
+template<class T>
+class NaiveRemotePtr
+{
+public:
+    NaiveRemotePtr() = default;
+
+    NaiveRemotePtr(const NaiveRemotePtr& other) : client(other.client), id(other.id)
+    {
+        if (client != nullptr)
+        {
+            client->requestWeight(id, 1);   // Round trip. (It can't be gone, `other` is keeping it alive)
+            client->live++;
+        }
+    }
+
+    NaiveRemotePtr(NaiveRemotePtr&& other) noexcept : client(std::exchange(other.client, nullptr)), id(other.id) {}
+
+    NaiveRemotePtr& operator=(NaiveRemotePtr other) noexcept
+    {
+        std::swap(client, other.client);
+        std::swap(id, other.id);
+        return *this;
+    }
+
+    ~NaiveRemotePtr()
+    {
+        if (client != nullptr)
+        {
+            client->live--;
+            client->releaseNow(id, 1);
+        }
+    }
+
+    std::uint64_t remoteId() const { return id; }
+    explicit operator bool() const { return client != nullptr; }
+
+private:
+    friend class RemoteClient;
+
+    RemoteClient* client = nullptr;
+    std::uint64_t id = 0;
+
+    NaiveRemotePtr(RemoteClient* client, std::uint64_t id) : client(client), id(id)
+    {
+        client->live++;
+    }
+};
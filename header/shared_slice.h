@@ -0,0 +1,132 @@
+/*
+Shared Slices
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// shared_ptr has a constructor that main.cpp shows with Mojo Jojo's name, the "aliasing constructor":
+//
+//     std::shared_ptr<std::string> name(mojo, &mojo->name);
+//
+// It shares mojo's reference count (no new control block, no allocation), but points at something else.
+// That's all we need to hand out pieces of a big object while keeping the whole thing alive:
+//
+//   shareMember(person, &Person::name)    a shared_ptr to one member of a shared object.
+//   SharedSlice<T>                        a range of elements inside a shared array. Slicing it again is just another aliasing copy.
+//   SharedStringView                      a std::string_view that keeps the string it looks at alive.
+//
+// Compared to copying a substring out, a slice costs one atomic increment no matter how long it is.
+
+
+template<class Owner, class Member>
+std::shared_ptr<Member> shareMember(const std::shared_ptr<Owner>& owner, Member Owner::* member)
+{
+    if (owner == nullptr)
+    {
+        return nullptr;
+    }
+    return std::shared_ptr<Member>(owner, &((*owner).*member));
+}
+
+
+template<class T>
+class SharedSlice
+{
+public:
+    SharedSlice() = default;
+
+    // The whole array. (The array has to know its size, shared_ptr<T[]> doesn't remember it for us)
+    SharedSlice(const std::shared_ptr<T[]>& array, std::size_t count) : first(array, array.get()), count(count) {}
+
+    // Any other owner, with a pointer into it.
+    template<class Owner>
+    SharedSlice(const std::shared_ptr<Owner>& owner, T* first, std::size_t count) : first(owner, first), count(count) {}
+
+    // A piece of this slice. Cut off at the end if it runs past it.
+    SharedSlice slice(std::size_t offset, std::size_t length = static_cast<std::size_t>(-1)) const
+    {
+        if (offset > count)
+        {
+            offset = count;
+        }
+        if (length > count - offset)
+        {
+            length = count - offset;
+        }
+        return SharedSlice(first, first.get() + offset, length);
+    }
+
+    T& operator[](std::size_t i) const { return first.get()[i]; }
+    T* data() const { return first.get(); }
+    T* begin() const { return first.get(); }
+    T* end() const { return first.get() + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // How many owners the whole array has, this slice included.
+    long use_count() const { return first.use_count(); }
+
+private:
+    std::shared_ptr<T> first;
+    std::size_t count = 0;
+};
+
+
+class SharedStringView
+{
+public:
+    SharedStringView() = default;
+
+    // Only a const string: one that can still be changed can move its characters (or cut them off) under our view.
+    explicit SharedStringView(const std::shared_ptr<const std::string>& text)
+        : first(text, text == nullptr ? nullptr : text->data()), length(text == nullptr ? 0 : text->size()) {}
+
+    explicit SharedStringView(const std::shared_ptr<std::string>& text) = delete;
+
+    // Like std::string::substr, but nothing is copied, and a position past the end gives an empty view instead of throwing.
+    SharedStringView substr(std::size_t position, std::size_t count = std::string::npos) const
+    {
+        if (position > length)
+        {
+            position = length;
+        }
+        if (count > length - position)
+        {
+            count = length - position;
+        }
+        SharedStringView piece;
+        piece.first = std::shared_ptr<const char>(first, first.get() + position);
+        piece.length = count;
+        return piece;
+    }
+
+    std::string_view view() const { return std::string_view(first.get(), length); }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(first.get(), length); }
+
+    const char* data() const { return first.get(); }
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    char operator[](std::size_t i) const { return first.get()[i]; }
+
+private:
+    std::shared_ptr<const char> first;
+    std::size_t length = 0;
+};
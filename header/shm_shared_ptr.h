@@ -0,0 +1,923 @@
+/*
+Process Shared Pointers
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifdef _WIN32
+#error "header/shm_shared_ptr.h needs POSIX shared memory (shm_open, robust process shared mutexes)"
+#endif
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// main.cpp's Professor is shared by his three daughters. Here he's shared by several PROCESSES: he lives in a
+// POSIX shared memory segment that each of them maps, and they all count references to him.
+//
+//     ShmSegment segment("/people", 64 << 20);                           // One process makes it...
+//     ShmSegment::Scope use(segment);                                    // (this thread's pointers are into `segment`)
+//     ShmSharedPtr<ShmPerson> professor = makeShmShared<ShmPerson>("Professor");
+//     segment.setRoot(0, professor);                                   // ...and leaves the Professor where others can find him.
+//
+//     ShmSegment segment("/people");                                     // Another process opens it.
+//     ShmSegment::Scope use(segment);
+//     ShmSharedPtr<ShmPerson> professor = segment.root<ShmPerson>(0);
+//
+// The segment is mapped at a different address in every process, so nothing in it may hold a real address.
+// Pointers stored INSIDE the segment (a person's parent) are ShmRefs, which only keep the index of a control block.
+// Pointers held by a process (locals, members of normal objects) are ShmSharedPtr and ShmWeakPtr.
+//
+// The counting, and why it survives a crash:
+//   - Every control block has a strong word: the low 32 bits say WHICH processes hold ShmSharedPtrs to it (one bit each),
+//     the high 32 bits count the ShmRefs stored in the segment.
+//   - Each process counts its own ShmSharedPtrs privately. Only the first one sets the process's bit, and only
+//     letting go of the last one clears it. Copying a ShmSharedPtr never touches the shared cache line.
+//   - The weak word is the same for ShmWeakPtrs, plus one bit that's set while the object exists.
+//   - The object is destroyed when its strong word reaches 0, the control block is freed when its weak word does.
+// If a process dies without letting go (crash, kill -9), its references are just its bit in each word.
+// reapDeadProcesses() finds processes that aren't running any more and clears their bits everywhere, destroying
+// whatever they were the last holder of. Clearing a bit is harmless if it's already clear, so it doesn't matter
+// what the dead process was in the middle of.
+//
+// Rules:
+//   - At most 32 processes attached at once.
+//   - Every type stored in a segment needs `static constexpr std::uint32_t ShmTypeId`, the same in every process,
+//     and every process has to registerType<T>() it (makeShmShared does it for you). The reaper finds destructors by that id.
+//   - The pointers don't know which segment they're in, so like compressed pointers (header/compressed_ptr.h),
+//     every thread that makes, uses or lets go of them opens a ShmSegment::Scope for it first. Scopes nest, the innermost one wins.
+//   - The segment has to outlive the process's ShmSharedPtrs, ShmWeakPtrs, ShmRefs and Scopes: let go of them all before
+//     destroying it. Its destructor hands back what the process still holds, and a pointer left over after that
+//     would count against a segment that's no longer mapped.
+//   - After fork(), the child calls reattachAfterFork() before anything else. Its copies of the parent's pointers
+//     then count as the child's own.
+//   - Roots (setRoot) are for setting up: don't change them while other processes are reading them.
+//   - A ShmRef being assigned at the moment its process dies can be off by one. Only process references are crash proof.
+//   - Liveness is checked with kill(pid, 0), so a dead process whose pid was already reused looks alive until that one exits.
+
+class ShmSegment;
+template<class T>
+class ShmSharedPtr;
+template<class T>
+class ShmRef;
+template<class T>
+class ShmWeakPtr;
+
+namespace shm_detail
+{
+    const std::uint32_t MaxProcesses = 32;
+    const std::uint64_t StoredOne = static_cast<std::uint64_t>(1) << 32;      // One ShmRef, in the high half of the strong word.
+    const std::uint64_t ObjectAlive = static_cast<std::uint64_t>(1) << 63;    // In the weak word.
+    const std::uint32_t NoIndex = 0xffffffffu;
+    const std::uint64_t Magic = 0x53484d5054520001ull;
+    const std::size_t Alignment = 16;
+    const std::size_t SmallClasses = 64;    // Freed objects up to 64 * 16 bytes are kept for reuse, bigger ones aren't.
+    const std::size_t Roots = 16;
+
+    struct Block
+    {
+        std::atomic<std::uint64_t> strong;
+        std::atomic<std::uint64_t> weak;
+        std::uint64_t object;           // Where the object is, from the start of the segment.
+        std::uint32_t bytes;
+        std::uint32_t type;
+        std::uint32_t nextFree;
+    };
+
+    struct Header
+    {
+        std::uint64_t magic;
+        std::uint64_t bytes;
+        std::uint64_t blocksAt;
+        std::uint64_t heapAt;
+        std::uint64_t used;                             // Everything from here up is unused.
+        std::uint64_t freeObjects[SmallClasses + 1];    // Free lists by size class (0 is an empty list).
+        std::uint32_t blockCount;
+        std::uint32_t freeBlocks;                       // Free list of control blocks.
+        pthread_mutex_t mutex;                          // For allocating. Robust, so a process dying while holding it doesn't hang the rest.
+        std::atomic<std::int32_t> processes[MaxProcesses];     // pid per slot: 0 is free, negative is being reaped.
+        std::atomic<std::uint32_t> roots[Roots];
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "counts in shared memory have to be lock free to work across processes");
+    static_assert(std::atomic<std::int32_t>::is_always_lock_free, "slots in shared memory have to be lock free to work across processes");
+}
+
+
+class ShmSegment
+{
+public:
+    typedef shm_detail::Block Block;
+
+    // Makes a new segment called `name` ("/something"), replacing any old one, and attaches this process to it.
+    ShmSegment(const std::string& name, std::size_t bytes, std::uint32_t blocks = 65536) : name(name)
+    {
+        shm_unlink(name.c_str());
+        int file = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (file < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+
+        std::size_t blocksAt = roundUp(sizeof(shm_detail::Header));
+        std::size_t heapAt = roundUp(blocksAt + blocks * sizeof(Block));
+        mapped = heapAt + roundUp(bytes);
+        if (ftruncate(file, static_cast<off_t>(mapped)) != 0)
+        {
+            int error = errno;
+            close(file);
+            throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+        }
+        map(file);
+
+        // A fresh segment is all zeros, which is already right for the counts, the free lists and the process slots.
+        header->bytes = mapped;
+        header->blocksAt = blocksAt;
+        header->heapAt = heapAt;
+        header->used = heapAt;
+        header->blockCount = blocks;
+        for (std::uint32_t i = 0; i < blocks; i++)
+        {
+            block(i).nextFree = i + 1 < blocks ? i + 1 : shm_detail::NoIndex;
+        }
+        header->freeBlocks = 0;
+        for (std::atomic<std::uint32_t>& root : header->roots)
+        {
+            root.store(shm_detail::NoIndex, std::memory_order_relaxed);
+        }
+
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = shm_detail::Magic;     // Last, so a process opening it early can tell it isn't ready.
+        attach();
+    }
+
+    // Opens a segment another process made, and attaches this process to it.
+    explicit ShmSegment(const std::string& name) : name(name)
+    {
+        int file = shm_open(name.c_str(), O_RDWR, 0600);
+        if (file < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0)
+        {
+            int error = errno;
+            close(file);
+            throw std::system_error(error, std::generic_category(), "fstat " + name);
+        }
+        mapped = static_cast<std::size_t>(info.st_size);
+        map(file);
+        if (header->magic != shm_detail::Magic)
+        {
+            munmap(base, mapped);
+            throw std::runtime_error("shared memory segment " + name + " isn't ready (or isn't one of ours)");
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        attach();
+    }
+
+    // Lets go of everything this process still holds, as if it had died, then unmaps.
+    ~ShmSegment()
+    {
+        assert(scopes.load() == 0 && "ShmSegment destroyed inside a Scope that uses it");
+        if (slot >= 0)
+        {
+            Scope use(*this);   // Destructors of what we were the last holder of let go of their ShmRefs.
+            reapSlot(static_cast<std::uint32_t>(slot));
+            header->processes[slot].store(0);
+        }
+        munmap(base, mapped);
+    }
+
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+
+    // Removes the name, so no new process can open it. (The memory stays until everyone has unmapped it)
+    static void remove(const std::string& name)
+    {
+        shm_unlink(name.c_str());
+    }
+
+    // Makes `segment` the one this thread's shared memory pointers are in, until the scope ends.
+    class Scope
+    {
+    public:
+        explicit Scope(ShmSegment& segment) : segment(segment), previous(active)
+        {
+            active = &segment;
+            segment.scopes++;
+        }
+
+        ~Scope()
+        {
+            assert(active == &segment && "ShmSegment::Scopes have to end in the reverse order they started");
+            segment.scopes--;
+            active = previous;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ShmSegment& segment;
+        ShmSegment* previous;
+    };
+
+    // The segment of the innermost Scope on this thread.
+    static ShmSegment& current()
+    {
+        assert(active != nullptr && "shared memory pointers used without a ShmSegment::Scope on this thread");
+        return *active;
+    }
+
+    template<class T>
+    void registerType()
+    {
+        std::lock_guard<std::mutex> lock(typesMutex);
+        destructors[T::ShmTypeId] = [](void* object) { static_cast<T*>(object)->~T(); };
+    }
+
+    // Call in the child right after fork(). The child gets its own process slot, and takes over
+    // the references its copies of the parent's ShmSharedPtrs and ShmWeakPtrs stand for.
+    // (Fork only while no other thread is using the segment)
+    void reattachAfterFork()
+    {
+        attach();
+        for (std::uint32_t i = 0; i < header->blockCount; i++)
+        {
+            holdingStrong[i] = localStrong[i].load(std::memory_order_relaxed) > 0;
+            if (holdingStrong[i])
+            {
+                block(i).strong.fetch_or(bit, std::memory_order_relaxed);
+            }
+            holdingWeak[i] = localWeak[i].load(std::memory_order_relaxed) > 0;
+            if (holdingWeak[i])
+            {
+                block(i).weak.fetch_or(bit, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Finds attached processes that have died and lets go of everything they held. Returns how many it found.
+    // Cheap enough to call every now and then (it's a pass over the process slots, and over the control blocks per dead one),
+    // or when a worker process is known to have exited (waitpid said so).
+    std::size_t reapDeadProcesses()
+    {
+        Scope use(*this);
+        std::size_t reaped = 0;
+        for (std::uint32_t s = 0; s < shm_detail::MaxProcesses; s++)
+        {
+            std::int32_t pid = header->processes[s].load();
+            if (pid <= 0 || static_cast<int>(s) == slot || kill(pid, 0) == 0 || errno != ESRCH)
+            {
+                continue;
+            }
+            if (!header->processes[s].compare_exchange_strong(pid, -pid))
+            {
+                continue;   // Someone else is reaping it.
+            }
+            reapSlot(s);
+            header->processes[s].store(0);
+            reaped++;
+        }
+        return reaped;
+    }
+
+    // Makes `object` findable by other processes, by number. Counts as a ShmRef, so it keeps the object alive.
+    template<class T>
+    void setRoot(std::size_t number, const ShmSharedPtr<T>& object);
+
+    template<class T>
+    ShmSharedPtr<T> root(std::size_t number);
+
+    // How many objects exist in the segment right now (all processes together).
+    std::size_t liveObjects() const
+    {
+        std::size_t live = 0;
+        for (std::uint32_t i = 0; i < header->blockCount; i++)
+        {
+            if (block(i).weak.load(std::memory_order_relaxed) & shm_detail::ObjectAlive)
+            {
+                live++;
+            }
+        }
+        return live;
+    }
+
+private:
+    template<class T>
+    friend class ShmSharedPtr;
+    template<class T>
+    friend class ShmWeakPtr;
+    template<class T>
+    friend class ShmRef;
+    template<class T, class... Args>
+    friend ShmSharedPtr<T> makeShmShared(Args&&... args);
+
+    std::string name;
+    char* base = nullptr;
+    shm_detail::Header* header = nullptr;
+    std::size_t mapped = 0;
+    int slot = -1;
+    std::uint64_t bit = 0;
+
+    // This process's own counts, per control block. holding* say whether our bit is set in the block's words,
+    // and only change under `transitions`.
+    std::unique_ptr<std::atomic<long>[]> localStrong;
+    std::unique_ptr<std::atomic<long>[]> localWeak;
+    std::unique_ptr<bool[]> holdingStrong;
+    std::unique_ptr<bool[]> holdingWeak;
+    std::mutex transitions;
+
+    std::mutex typesMutex;
+    std::unordered_map<std::uint32_t, void (*)(void*)> destructors;
+
+    std::atomic<std::size_t> scopes{ 0 };
+    inline static thread_local ShmSegment* active = nullptr;
+
+    static std::size_t roundUp(std::size_t bytes)
+    {
+        return (bytes + 4095) / 4096 * 4096;
+    }
+
+    void map(int file)
+    {
+        void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        close(file);
+        if (memory == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        base = static_cast<char*>(memory);
+        header = reinterpret_cast<shm_detail::Header*>(base);
+    }
+
+    void attach()
+    {
+        std::int32_t me = static_cast<std::int32_t>(getpid());
+        slot = -1;
+        for (std::uint32_t s = 0; s < shm_detail::MaxProcesses && slot < 0; s++)
+        {
+            std::int32_t empty = 0;
+            if (header->processes[s].compare_exchange_strong(empty, me))
+            {
+                slot = static_cast<int>(s);
+            }
+        }
+        if (slot < 0)
+        {
+            reapDeadProcesses();    // Maybe some of them are gone.
+            for (std::uint32_t s = 0; s < shm_detail::MaxProcesses && slot < 0; s++)
+            {
+                std::int32_t empty = 0;
+                if (header->processes[s].compare_exchange_strong(empty, me))
+                {
+                    slot = static_cast<int>(s);
+                }
+            }
+            if (slot < 0)
+            {
+                throw std::runtime_error("more than 32 processes attached to " + name);
+            }
+        }
+        bit = static_cast<std::uint64_t>(1) << slot;
+
+        if (localStrong == nullptr)
+        {
+            localStrong.reset(new std::atomic<long>[header->blockCount]());
+            localWeak.reset(new std::atomic<long>[header->blockCount]());
+            holdingStrong.reset(new bool[header->blockCount]());
+            holdingWeak.reset(new bool[header->blockCount]());
+        }
+    }
+
+    Block& block(std::uint32_t index) const
+    {
+        return reinterpret_cast<Block*>(base + header->blocksAt)[index];
+    }
+
+    void* objectAt(std::uint32_t index) const
+    {
+        return base + block(index).object;
+    }
+
+    // The allocator lock. If its last owner died holding it, we get it anyway (EOWNERDEAD) and carry on:
+    // the free lists change with single stores, so at worst the dead process leaked what it was allocating.
+    class SegmentLock
+    {
+    public:
+        explicit SegmentLock(pthread_mutex_t* mutex) : mutex(mutex)
+        {
+            if (pthread_mutex_lock(mutex) == EOWNERDEAD)
+            {
+                pthread_mutex_consistent(mutex);
+            }
+        }
+
+        ~SegmentLock()
+        {
+            pthread_mutex_unlock(mutex);
+        }
+
+    private:
+        pthread_mutex_t* mutex;
+    };
+
+    std::uint64_t allocateObject(std::size_t bytes)
+    {
+        std::size_t size = (bytes + shm_detail::Alignment - 1) / shm_detail::Alignment;
+        SegmentLock lock(&header->mutex);
+        if (size <= shm_detail::SmallClasses && header->freeObjects[size] != 0)
+        {
+            std::uint64_t offset = header->freeObjects[size];
+            header->freeObjects[size] = *reinterpret_cast<std::uint64_t*>(base + offset);
+            return offset;
+        }
+        if (header->used + size * shm_detail::Alignment > header->bytes)
+        {
+            throw std::bad_alloc();
+        }
+        std::uint64_t offset = header->used;
+        header->used += size * shm_detail::Alignment;
+        return offset;
+    }
+
+    void freeObject(std::uint64_t offset, std::size_t bytes)
+    {
+        std::size_t size = (bytes + shm_detail::Alignment - 1) / shm_detail::Alignment;
+        if (size > shm_detail::SmallClasses)
+        {
+            return;     // Big objects aren't reused. (Keep big things out of the segment, or make it bigger)
+        }
+        SegmentLock lock(&header->mutex);
+        *reinterpret_cast<std::uint64_t*>(base + offset) = header->freeObjects[size];
+        header->freeObjects[size] = offset;
+    }
+
+    std::uint32_t allocateBlock()
+    {
+        SegmentLock lock(&header->mutex);
+        std::uint32_t index = header->freeBlocks;
+        if (index == shm_detail::NoIndex)
+        {
+            throw std::bad_alloc();
+        }
+        header->freeBlocks = block(index).nextFree;
+        return index;
+    }
+
+    void freeBlock(std::uint32_t index)
+    {
+        SegmentLock lock(&header->mutex);
+        block(index).nextFree = header->freeBlocks;
+        header->freeBlocks = index;
+    }
+
+    // The strong word reached 0: run the destructor (found by type id) and give back the memory.
+    void destroyObject(std::uint32_t index)
+    {
+        Block& dead = block(index);
+        void (*destroy)(void*) = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(typesMutex);
+            auto found = destructors.find(dead.type);
+            if (found != destructors.end())
+            {
+                destroy = found->second;
+            }
+        }
+        if (destroy == nullptr)
+        {
+            return;     // Not registered in this process: we can't destroy it, so it's leaked rather than half destroyed.
+        }
+        destroy(objectAt(index));
+        freeObject(dead.object, dead.bytes);
+        if (dead.weak.fetch_and(~shm_detail::ObjectAlive, std::memory_order_acq_rel) == shm_detail::ObjectAlive)
+        {
+            freeBlock(index);
+        }
+    }
+
+    // Clears a process's bit everywhere. For dead processes, and for ourselves when detaching.
+    void reapSlot(std::uint32_t s)
+    {
+        std::uint64_t dead = static_cast<std::uint64_t>(1) << s;
+        for (std::uint32_t i = 0; i < header->blockCount; i++)
+        {
+            Block& reaped = block(i);
+            if (reaped.strong.fetch_and(~dead, std::memory_order_acq_rel) == dead)
+            {
+                destroyObject(i);
+            }
+            if (reaped.weak.fetch_and(~dead, std::memory_order_acq_rel) == dead)
+            {
+                freeBlock(i);
+            }
+        }
+    }
+
+    // Strong references held by this process. Only the first and last ones touch the shared word.
+    void addStrong(std::uint32_t index)
+    {
+        if (localStrong[index].fetch_add(1, std::memory_order_relaxed) == 0)
+        {
+            syncStrong(index);
+        }
+    }
+
+    void releaseStrong(std::uint32_t index)
+    {
+        if (localStrong[index].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            syncStrong(index);
+        }
+    }
+
+    // Makes our bit match our count. Threads can race each other between their count change and getting here,
+    // so this looks at the count as it is now instead of trusting what the caller saw.
+    void syncStrong(std::uint32_t index)
+    {
+        bool destroy = false;
+        {
+            std::lock_guard<std::mutex> lock(transitions);
+            bool want = localStrong[index].load(std::memory_order_acquire) > 0;
+            if (want && !holdingStrong[index])
+            {
+                block(index).strong.fetch_or(bit, std::memory_order_acq_rel);
+                holdingStrong[index] = true;
+            }
+            else if (!want && holdingStrong[index])
+            {
+                holdingStrong[index] = false;
+                destroy = block(index).strong.fetch_and(~bit, std::memory_order_acq_rel) == bit;
+            }
+        }
+        if (destroy)
+        {
+            destroyObject(index);
+        }
+    }
+
+    // weak_ptr::lock(): a strong reference, only if the object still exists.
+    bool tryAddStrong(std::uint32_t index)
+    {
+        std::lock_guard<std::mutex> lock(transitions);
+        if (holdingStrong[index])
+        {
+            localStrong[index].fetch_add(1, std::memory_order_relaxed);     // Our bit is set, so it's alive.
+            return true;
+        }
+        std::uint64_t word = block(index).strong.load(std::memory_order_acquire);
+        while (word != 0)
+        {
+            if (block(index).strong.compare_exchange_weak(word, word | bit, std::memory_order_acq_rel))
+            {
+                holdingStrong[index] = true;
+                localStrong[index].fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void addWeak(std::uint32_t index)
+    {
+        if (localWeak[index].fetch_add(1, std::memory_order_relaxed) == 0)
+        {
+            syncWeak(index);
+        }
+    }
+
+    void releaseWeak(std::uint32_t index)
+    {
+        if (localWeak[index].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            syncWeak(index);
+        }
+    }
+
+    void syncWeak(std::uint32_t index)
+    {
+        bool free = false;
+        {
+            std::lock_guard<std::mutex> lock(transitions);
+            bool want = localWeak[index].load(std::memory_order_acquire) > 0;
+            if (want && !holdingWeak[index])
+            {
+                block(index).weak.fetch_or(bit, std::memory_order_acq_rel);
+                holdingWeak[index] = true;
+            }
+            else if (!want && holdingWeak[index])
+            {
+                holdingWeak[index] = false;
+                free = block(index).weak.fetch_and(~bit, std::memory_order_acq_rel) == bit;
+            }
+        }
+        if (free)
+        {
+            freeBlock(index);
+        }
+    }
+
+    // ShmRefs: counted right in the shared word (they belong to the segment, not to a process).
+    void addStored(std::uint32_t index)
+    {
+        block(index).strong.fetch_add(shm_detail::StoredOne, std::memory_order_relaxed);
+    }
+
+    void releaseStored(std::uint32_t index)
+    {
+        if (block(index).strong.fetch_sub(shm_detail::StoredOne, std::memory_order_acq_rel) == shm_detail::StoredOne)
+        {
+            destroyObject(index);
+        }
+    }
+};
+
+
+// A process's pointer to an object in the segment. Copies only count inside this process.
+template<class T>
+class ShmSharedPtr
+{
+public:
+    ShmSharedPtr() = default;
+    ShmSharedPtr(std::nullptr_t) {}
+
+    ShmSharedPtr(const ShmSharedPtr& other) : object(other.object), index(other.index)
+    {
+        if (object != nullptr)
+        {
+            ShmSegment::current().addStrong(index);
+        }
+    }
+
+    ShmSharedPtr(ShmSharedPtr&& other) noexcept : object(std::exchange(other.object, nullptr)), index(std::exchange(other.index, shm_detail::NoIndex)) {}
+
+    ShmSharedPtr& operator=(ShmSharedPtr other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~ShmSharedPtr()
+    {
+        if (object != nullptr)
+        {
+            ShmSegment::current().releaseStrong(index);
+        }
+    }
+
+    void reset()
+    {
+        ShmSharedPtr().swap(*this);
+    }
+
+    void swap(ShmSharedPtr& other) noexcept
+    {
+        std::swap(object, other.object);
+        std::swap(index, other.index);
+    }
+
+    T* get() const { return object; }
+    T& operator*() const { return *object; }
+    T* operator->() const { return object; }
+    explicit operator bool() const { return object != nullptr; }
+    bool operator==(std::nullptr_t) const { return object == nullptr; }
+
+private:
+    template<class U>
+    friend class ShmRef;
+    template<class U>
+    friend class ShmWeakPtr;
+    template<class U, class... Args>
+    friend ShmSharedPtr<U> makeShmShared(Args&&... args);
+    friend class ShmSegment;
+
+    T* object = nullptr;
+    std::uint32_t index = shm_detail::NoIndex;
+
+    // Takes over a reference that has already been counted.
+    ShmSharedPtr(std::uint32_t index, bool) : object(static_cast<T*>(ShmSegment::current().objectAt(index))), index(index) {}
+};
+
+
+// A pointer stored inside the segment (a member of an object that lives there). Just a control block index,
+// so it means the same thing in every process. Counted in the shared word.
+template<class T>
+class ShmRef
+{
+public:
+    ShmRef() = default;
+    ShmRef(std::nullptr_t) {}
+
+    ShmRef(const ShmSharedPtr<T>& owner) : index(owner.index)
+    {
+        if (index != shm_detail::NoIndex)
+        {
+            ShmSegment::current().addStored(index);
+        }
+    }
+
+    ShmRef(const ShmRef& other) : index(other.index)
+    {
+        if (index != shm_detail::NoIndex)
+        {
+            ShmSegment::current().addStored(index);
+        }
+    }
+
+    ShmRef& operator=(ShmRef other) noexcept
+    {
+        std::swap(index, other.index);
+        return *this;
+    }
+
+    ~ShmRef()
+    {
+        if (index != shm_detail::NoIndex)
+        {
+            ShmSegment::current().releaseStored(index);
+        }
+    }
+
+    // A process pointer to the same object (counts in this process from then on).
+    ShmSharedPtr<T> lock() const
+    {
+        if (index == shm_detail::NoIndex)
+        {
+            return ShmSharedPtr<T>();
+        }
+        ShmSegment::current().addStrong(index);     // We hold a ShmRef, so it's alive.
+        return ShmSharedPtr<T>(index, true);
+    }
+
+    T* get() const { return index == shm_detail::NoIndex ? nullptr : static_cast<T*>(ShmSegment::current().objectAt(index)); }
+    T& operator*() const { return *get(); }
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return index != shm_detail::NoIndex; }
+
+private:
+    std::uint32_t index = shm_detail::NoIndex;
+};
+
+
+template<class T>
+class ShmWeakPtr
+{
+public:
+    ShmWeakPtr() = default;
+
+    ShmWeakPtr(const ShmSharedPtr<T>& shared) : index(shared.index)
+    {
+        if (index != shm_detail::NoIndex)
+        {
+            ShmSegment::current().addWeak(index);
+        }
+    }
+
+    ShmWeakPtr(const ShmWeakPtr& other) : index(other.index)
+    {
+        if (index != shm_detail::NoIndex)
+        {
+            ShmSegment::current().addWeak(index);
+        }
+    }
+
+    ShmWeakPtr& operator=(ShmWeakPtr other) noexcept
+    {
+        std::swap(index, other.index);
+        return *this;
+    }
+
+    ~ShmWeakPtr()
+    {
+        if (index != shm_detail::NoIndex)
+        {
+            ShmSegment::current().releaseWeak(index);
+        }
+    }
+
+    ShmSharedPtr<T> lock() const
+    {
+        if (index != shm_detail::NoIndex && ShmSegment::current().tryAddStrong(index))
+        {
+            return ShmSharedPtr<T>(index, true);
+        }
+        return ShmSharedPtr<T>();
+    }
+
+    bool expired() const
+    {
+        return index == shm_detail::NoIndex || ShmSegment::current().block(index).strong.load(std::memory_order_relaxed) == 0;
+    }
+
+private:
+    std::uint32_t index = shm_detail::NoIndex;
+};
+
+
+// Like make_shared, in the current segment.
+template<class T, class... Args>
+ShmSharedPtr<T> makeShmShared(Args&&... args)
+{
+    static_assert(alignof(T) <= shm_detail::Alignment, "the segment only lines things up on 16 bytes");
+    ShmSegment& segment = ShmSegment::current();
+    segment.registerType<T>();
+
+    std::uint32_t index = segment.allocateBlock();
+    ShmSegment::Block& block = segment.block(index);
+    try
+    {
+        block.object = segment.allocateObject(sizeof(T));
+    }
+    catch (...)
+    {
+        segment.freeBlock(index);
+        throw;
+    }
+    try
+    {
+        new (segment.base + block.object) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        segment.freeObject(block.object, sizeof(T));
+        segment.freeBlock(index);
+        throw;
+    }
+    block.bytes = static_cast<std::uint32_t>(sizeof(T));
+    block.type = T::ShmTypeId;
+    block.weak.store(shm_detail::ObjectAlive, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(segment.transitions);
+        segment.localStrong[index].store(1, std::memory_order_relaxed);
+        segment.holdingStrong[index] = true;
+        block.strong.store(segment.bit, std::memory_order_release);
+    }
+    return ShmSharedPtr<T>(index, true);
+}
+
+
+template<class T>
+void ShmSegment::setRoot(std::size_t number, const ShmSharedPtr<T>& object)
+{
+    if (object.index != shm_detail::NoIndex)
+    {
+        addStored(object.index);
+    }
+    std::uint32_t old = header->roots[number].exchange(object.index, std::memory_order_acq_rel);
+    if (old != shm_detail::NoIndex)
+    {
+        releaseStored(old);
+    }
+}
+
+template<class T>
+ShmSharedPtr<T> ShmSegment::root(std::size_t number)
+{
+    std::uint32_t index = header->roots[number].load(std::memory_order_acquire);
+    if (index == shm_detail::NoIndex)
+    {
+        return ShmSharedPtr<T>();
+    }
+    addStrong(index);   // The root holds a ShmRef's worth, so it's alive.
+    return ShmSharedPtr<T>(index, true);
+}
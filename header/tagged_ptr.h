@@ -0,0 +1,215 @@
+/*
+Tagged Smart Pointers
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "pointer_bits.h"
+
+// Say every Person also needs a "generation" number and a "dirty" flag:
+//
+//     std::unique_ptr<Person> parent;     // 8 bytes
+//     std::uint16_t generation;           // 2 bytes
+//     bool dirty;                         // 1 byte, and then padding up to the next 8.
+//
+// The pointer already has room for both (see pointer_bits.h): 16 spare high bits for the generation,
+// and a few spare low bits for flags. These pointers keep them there:
+//
+//   TaggedUniquePtr<T>    a unique_ptr with a 16 bit tag() and some flags(). Still 8 bytes.
+//   TaggedCountedPtr<T>   a reference counted pointer with the same extras. Also 8 bytes (a shared_ptr is 16),
+//                         the count lives in front of the object, so make them with makeTaggedCounted.
+//
+// The tag and flags belong to the pointer, not to the object: two TaggedCountedPtrs to the same Person
+// can have different tags. Moving a pointer moves its tag and flags with it, copying copies them.
+// (On 32 bit builds there are no spare high bits and tag() is always 0)
+
+
+template<class T, class Deleter = std::default_delete<T>>
+class TaggedUniquePtr
+{
+public:
+    // (Functions, not constants, so a Person can hold a TaggedUniquePtr<Person> before Person is complete)
+    static constexpr unsigned flagBits() { return pointer_bits::lowBits<T>(); }
+    static constexpr unsigned tagBits() { return pointer_bits::HighBits; }
+
+    TaggedUniquePtr() = default;
+    TaggedUniquePtr(std::nullptr_t) {}
+    explicit TaggedUniquePtr(T* object, std::uint16_t tag = 0, unsigned flags = 0) : word(pointer_bits::pack(object, flags, tag)) {}
+    TaggedUniquePtr(T* object, Deleter deleter) : word(pointer_bits::pack(object, 0, 0)), deleter(std::move(deleter)) {}
+
+    TaggedUniquePtr(TaggedUniquePtr&& other) noexcept : word(std::exchange(other.word, 0)), deleter(std::move(other.deleter)) {}
+
+    TaggedUniquePtr& operator=(TaggedUniquePtr&& other) noexcept
+    {
+        std::uintptr_t taken = std::exchange(other.word, 0);    // Take it first: other might live inside the object we're about to delete.
+        Deleter takenDeleter = std::move(other.deleter);
+        reset();
+        word = taken;
+        deleter = std::move(takenDeleter);
+        return *this;
+    }
+
+    TaggedUniquePtr(const TaggedUniquePtr&) = delete;
+    TaggedUniquePtr& operator=(const TaggedUniquePtr&) = delete;
+
+    ~TaggedUniquePtr()
+    {
+        reset();
+    }
+
+    // Deletes the object, the tag and flags go back to 0.
+    void reset()
+    {
+        T* object = get();
+        word = 0;
+        if (object != nullptr)
+        {
+            deleter(object);
+        }
+    }
+
+    // Gives up the object without deleting it (like unique_ptr::release). The tag and flags are kept.
+    T* release()
+    {
+        T* object = get();
+        word &= ~pointer_bits::addressMask<T>();
+        return object;
+    }
+
+    T* get() const
+    {
+        static_assert(flagBits() >= 1, "TaggedUniquePtr needs at least one free low bit for flags");
+        return pointer_bits::pointer<T>(word);
+    }
+
+    T& operator*() const { return *get(); }
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return get() != nullptr; }
+
+    std::uint16_t tag() const { return static_cast<std::uint16_t>(pointer_bits::high(word)); }
+    void setTag(std::uint16_t tag) { word = pointer_bits::pack(get(), pointer_bits::low<T>(word), tag); }
+
+    unsigned flags() const { return static_cast<unsigned>(pointer_bits::low<T>(word)); }
+    void setFlags(unsigned flags) { word = pointer_bits::pack(get(), flags, pointer_bits::high(word)); }
+
+    bool flag(unsigned bit) const { return (flags() >> bit) & 1; }
+    void setFlag(unsigned bit, bool value) { setFlags(value ? flags() | (1u << bit) : flags() & ~(1u << bit)); }
+
+private:
+    std::uintptr_t word = 0;
+    [[no_unique_address]] Deleter deleter;     // Takes no space when it's empty, like std::default_delete.
+};
+
+
+namespace tagged_detail
+{
+    template<class T>
+    struct CountedBox
+    {
+        std::atomic<long> count{ 1 };
+        T value;
+
+        template<class... Args>
+        explicit CountedBox(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+}
+
+
+template<class T>
+class TaggedCountedPtr
+{
+    using Box = tagged_detail::CountedBox<T>;
+
+public:
+    static constexpr unsigned flagBits() { return pointer_bits::lowBits<Box>(); }
+    static constexpr unsigned tagBits() { return pointer_bits::HighBits; }
+
+    TaggedCountedPtr() = default;
+    TaggedCountedPtr(std::nullptr_t) {}
+
+    TaggedCountedPtr(const TaggedCountedPtr& other) : word(other.word)
+    {
+        if (box() != nullptr)
+        {
+            box()->count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    TaggedCountedPtr(TaggedCountedPtr&& other) noexcept : word(std::exchange(other.word, 0)) {}
+
+    TaggedCountedPtr& operator=(TaggedCountedPtr other) noexcept
+    {
+        std::swap(word, other.word);
+        return *this;
+    }
+
+    ~TaggedCountedPtr()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        Box* object = box();
+        word = 0;
+        if (object != nullptr && object->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete object;
+        }
+    }
+
+    T* get() const { return box() == nullptr ? nullptr : &box()->value; }
+    T& operator*() const { return box()->value; }
+    T* operator->() const { return &box()->value; }
+    explicit operator bool() const { return box() != nullptr; }
+    long use_count() const { return box() == nullptr ? 0 : box()->count.load(std::memory_order_relaxed); }
+
+    std::uint16_t tag() const { return static_cast<std::uint16_t>(pointer_bits::high(word)); }
+    void setTag(std::uint16_t tag) { word = pointer_bits::pack(box(), pointer_bits::low<Box>(word), tag); }
+
+    unsigned flags() const { return static_cast<unsigned>(pointer_bits::low<Box>(word)); }
+    void setFlags(unsigned flags) { word = pointer_bits::pack(box(), flags, pointer_bits::high(word)); }
+
+    bool flag(unsigned bit) const { return (flags() >> bit) & 1; }
+    void setFlag(unsigned bit, bool value) { setFlags(value ? flags() | (1u << bit) : flags() & ~(1u << bit)); }
+
+private:
+    template<class U, class... Args>
+    friend TaggedCountedPtr<U> makeTaggedCounted(Args&&... args);
+
+    std::uintptr_t word = 0;
+
+    explicit TaggedCountedPtr(Box* object) : word(pointer_bits::pack(object, 0, 0)) {}
+
+    Box* box() const
+    {
+        static_assert(flagBits() >= 1, "TaggedCountedPtr needs at least one free low bit for flags");
+        return pointer_bits::pointer<Box>(word);
+    }
+};
+
+
+// Like make_shared: one allocation for the count and the object.
+template<class T, class... Args>
+TaggedCountedPtr<T> makeTaggedCounted(Args&&... args)
+{
+    return TaggedCountedPtr<T>(new tagged_detail::CountedBox<T>(std::forward<Args>(args)...));
+}
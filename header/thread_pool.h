@@ -0,0 +1,281 @@
+/*
+Work Stealing Thread Pool
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A thread pool runs small tasks on a fixed set of threads, instead of starting a thread per task.
+// In a work stealing pool every thread has its own queue of tasks:
+//   - A thread takes work from the BACK of its own queue (the newest task, which is probably still in its cache).
+//   - When its queue is empty it steals from the FRONT of somebody else's queue (the oldest, usually the biggest chunk).
+// Tasks that split themselves into smaller tasks (like parallelFor below) spread out over all the threads this way,
+// and the threads mostly leave each other alone.
+//
+// Each queue has its own small lock. A lock-free deque would be faster, but this is much easier to get right.
+// The one lock they all share is for falling asleep: a busy pool only counts submissions on an atomic, and only
+// takes that lock to wake a thread up when one is actually asleep.
+
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : queues(threadCount)
+    {
+        for (unsigned i = 0; i < threadCount; i++)
+        {
+            queues[i].reset(new Queue());
+        }
+        for (unsigned i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCondition.notify_all();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(queues.size()); }
+
+    // Which pool thread is running right now: 0 to size()-1, or size() if it's a thread outside the pool.
+    // Handy for giving each thread its own arena, buffer, etc.
+    unsigned workerIndex() const
+    {
+        return currentPool() == this ? currentIndex() : size();
+    }
+
+    // Adds a task. From inside a task, it goes on this thread's own queue, otherwise the queues take turns.
+    void submit(std::function<void()> task)
+    {
+        pending.fetch_add(1, std::memory_order_relaxed);
+
+        unsigned index = workerIndex();
+        if (index == size())
+        {
+            index = nextQueue.fetch_add(1, std::memory_order_relaxed) % size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        submitted.fetch_add(1);                             // Lets a thread that is about to fall asleep notice there's new work.
+        if (sleepers.load() != 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);   // Empty, but a sleeper is now either waiting (and gets the notify) or hasn't checked `submitted` yet.
+            }
+            sleepCondition.notify_one();
+        }
+    }
+
+    // Blocks until every submitted task (and every task those tasks submitted) has finished.
+    // Only from outside the pool: a task calling this would be waiting for itself to finish.
+    void wait()
+    {
+        assert(workerIndex() == size() && "WorkStealingPool::wait called from a task (use parallelFor, it only waits for its own work)");
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        doneCondition.wait(lock, [this]() { return pending.load(std::memory_order_acquire) == 0; });
+    }
+
+    // Calls body(i) for every i in [begin, end), split into chunks of roughly `grain` items.
+    // The range is split in half again and again, so the first few steals hand out huge pieces of work.
+    // It only waits for its own chunks, so it works from inside a task too (which then helps with the work meanwhile).
+    template<class Body>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body body)
+    {
+        std::shared_ptr<Loop<Body>> loop = std::make_shared<Loop<Body>>(std::move(body));
+        split(begin, end, std::max<std::size_t>(1, grain), loop);
+
+        unsigned index = workerIndex();
+        if (index != size())
+        {
+            while (loop->left.load(std::memory_order_acquire) != 0)
+            {
+                if (!runOne(index))
+                {
+                    std::this_thread::yield();
+                }
+            }
+            return;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        doneCondition.wait(lock, [&loop]() { return loop->left.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // One parallelFor: its body, and how many of its chunks are still queued or running.
+    template<class Body>
+    struct Loop
+    {
+        Body body;
+        std::atomic<std::size_t> left{ 0 };
+
+        explicit Loop(Body&& body) : body(std::move(body)) {}
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> pending{ 0 };
+    std::atomic<unsigned> nextQueue{ 0 };
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::condition_variable doneCondition;
+    bool stopping = false;                                  // Guarded by sleepMutex.
+    std::atomic<std::size_t> submitted{ 0 };                // Tasks ever submitted.
+    std::atomic<unsigned> sleepers{ 0 };                    // Threads that are asleep, or about to be.
+
+    static const WorkStealingPool*& currentPool()
+    {
+        static thread_local const WorkStealingPool* pool = nullptr;
+        return pool;
+    }
+
+    static unsigned& currentIndex()
+    {
+        static thread_local unsigned index = 0;
+        return index;
+    }
+
+    template<class Body>
+    void split(std::size_t begin, std::size_t end, std::size_t grain, const std::shared_ptr<Loop<Body>>& loop)
+    {
+        while (end - begin > grain)
+        {
+            std::size_t middle = begin + (end - begin) / 2;
+            loop->left.fetch_add(1, std::memory_order_relaxed);
+            submit([this, middle, end, grain, loop]()
+            {
+                split(middle, end, grain, loop);
+                if (loop->left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex);   // Same handshake as in runOne: a waiter is either asleep or hasn't looked yet.
+                    doneCondition.notify_all();
+                }
+            });
+            end = middle;
+        }
+        for (std::size_t i = begin; i < end; i++)
+        {
+            loop->body(i);
+        }
+    }
+
+    // Takes one task (our own newest first, then the oldest from the others) and runs it.
+    bool runOne(unsigned index)
+    {
+        std::function<void()> task;
+        if (!take(index, task))
+        {
+            return false;
+        }
+
+        task();
+
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            doneCondition.notify_all();
+        }
+        return true;
+    }
+
+    bool take(unsigned index, std::function<void()>& task)
+    {
+        {
+            Queue& own = *queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (unsigned offset = 1; offset < size(); offset++)
+        {
+            Queue& victim = *queues[(index + offset) % size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned index)
+    {
+        currentPool() = this;
+        currentIndex() = index;
+
+        for (;;)
+        {
+            std::size_t seen = submitted.load();
+
+            if (runOne(index))
+            {
+                continue;
+            }
+
+            // Nothing to do anywhere. Sleep until something new is submitted
+            // (if something came in after we looked at the queues, `submitted` has moved on and we don't sleep at all).
+            // sleepers goes up before we look at `submitted`, and submit() counts before it looks at sleepers
+            // (all sequentially consistent), so at least one of us sees the other: we don't sleep, or it wakes us.
+            sleepers.fetch_add(1);
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCondition.wait(lock, [this, seen]() { return stopping || submitted.load() != seen; });
+            sleepers.fetch_sub(1);
+            if (stopping)
+            {
+                return;
+            }
+        }
+    }
+};
@@ -0,0 +1,575 @@
+/*
+Tunable Smart Pointers
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "placed_shared_ptr.h"
+
+// Built with ThreadSanitizer? (GCC says so with __SANITIZE_THREAD__, clang with __has_feature)
+#if defined(__SANITIZE_THREAD__)
+#define TUNED_PTR_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define TUNED_PTR_TSAN 1
+#endif
+#endif
+#ifndef TUNED_PTR_TSAN
+#define TUNED_PTR_TSAN 0
+#endif
+
+// unique_ptr, shared_ptr and weak_ptr, written from scratch, so we can see (and change) how they work inside.
+// They behave like the std ones for everything main.cpp does, and then some:
+//
+//     TunedUniquePtr<Person> joe = makeTunedUnique<Person>("Joe the third");
+//     TunedSharedPtr<Person> professor = makeTunedShared<Person>("Professor");
+//     TunedWeakPtr<Person> weakPtr = professor;
+//
+// What can be tuned is collected in a "policy", a struct passed as a template parameter:
+//
+//   - Count:            the type of the counters (long, like std, or something smaller).
+//   - incrementOrder,   the memory orders for adding and removing a reference.
+//     decrementOrder
+//   - fenceOnZero:      if decrements are only `release`, the one that reaches zero needs an acquire fence
+//                       before destroying anything. (See header/pointer_switch.h for the std/tuned switch)
+//   - placement:        where makeTunedShared puts the control block (the ControlBlockPlacement from placed_shared_ptr.h).
+//   - immortals:        whether objects can be made immortal (see ImmortalRefCountPolicy), at the cost of one
+//                       plain load and a branch in front of every count change.
+//
+// Deleters live right in the control block next to the counts (no separate allocation, no std::function),
+// and the block knows how to destroy itself through two plain function pointers.
+//
+// Like std, the weak count starts at 1 and that 1 belongs to all the strong references together.
+// So the block is freed when the weak count reaches 0, which can only happen after the object is gone.
+
+
+// The same memory orders libstdc++ and MSVC use.
+struct DefaultRefCountPolicy
+{
+    typedef long Count;
+    static constexpr std::memory_order incrementOrder = std::memory_order_relaxed;
+    static constexpr std::memory_order decrementOrder = std::memory_order_acq_rel;
+    static constexpr bool fenceOnZero = false;
+    static constexpr ControlBlockPlacement placement = ControlBlockPlacement::CoLocated;
+    static constexpr bool immortals = false;
+};
+
+// Only as much ordering as counting actually needs:
+//   - Adding a reference is relaxed. You can only copy a pointer you already have, so the object can't go away meanwhile,
+//     and nothing else is published by the copy.
+//   - Dropping a reference is release: everything this thread did to the object happens before the count goes down.
+//   - Only the decrement that reaches zero needs to see all of that, so it alone does an acquire fence before destroying.
+// std pays for acquire on every decrement. On x86 that's free either way (every lock-prefixed instruction is a full barrier),
+// on ARM and POWER it isn't. source/litmus_refcount.cpp checks that this is still enough.
+struct RelaxedRefCountPolicy : DefaultRefCountPolicy
+{
+    static constexpr std::memory_order decrementOrder = std::memory_order_release;
+    static constexpr bool fenceOnZero = true;
+};
+
+// The Professor is shared by every child, and lives as long as the program does. Still, every copy of a pointer to him
+// does an atomic increment, and every copy going away an atomic decrement, all on the same cache line,
+// which has to bounce between every core that's copying.
+//
+// With this policy, a shared pointer can make its object immortal:
+//
+//     TunedSharedPtr<Person, ImmortalRefCountPolicy> professor = makeTunedShared<Person, ImmortalRefCountPolicy>("Professor");
+//     professor.makeImmortal();
+//
+// From then on, copying and dropping pointers to him only reads the count and skips the rest: nobody writes to
+// the cache line any more, so every core can keep its own copy of it. He is never destroyed (not even at exit),
+// and weak pointers to him never expire. That's the deal, so only do it to things that really live forever.
+//
+// Immortal is a count so big it can never count down to zero (half the largest Count), the same trick Python uses.
+// No extra field, and pointers that were counted before makeImmortal() can't bring it back to zero:
+// a decrement that sees the big count is skipped too, so the count can only go up from there.
+struct ImmortalRefCountPolicy : DefaultRefCountPolicy
+{
+    static constexpr bool immortals = true;
+};
+
+
+namespace tuned_detail
+{
+    template<class Policy>
+    struct ControlBlock
+    {
+        std::atomic<typename Policy::Count> strong{ 1 };
+        std::atomic<typename Policy::Count> weak{ 1 };
+        void (*destroyObject)(ControlBlock*) = nullptr;    // Strong count hit 0: destroy the object.
+        void (*destroyBlock)(ControlBlock*) = nullptr;     // Weak count hit 0: free the block (and the object's memory if it's inside).
+
+        static constexpr typename Policy::Count Immortal = std::numeric_limits<typename Policy::Count>::max() / 2;
+
+        static bool isImmortal(const std::atomic<typename Policy::Count>& counter)
+        {
+            return Policy::immortals && counter.load(std::memory_order_relaxed) >= Immortal;
+        }
+
+        void addStrong()
+        {
+            if (isImmortal(strong))
+            {
+                return;
+            }
+            strong.fetch_add(1, Policy::incrementOrder);
+        }
+
+        void addWeak()
+        {
+            if (isImmortal(weak))
+            {
+                return;
+            }
+            weak.fetch_add(1, Policy::incrementOrder);
+        }
+
+        void releaseStrong()
+        {
+            if (isImmortal(strong))
+            {
+                return;
+            }
+            if (strong.fetch_sub(1, Policy::decrementOrder) == 1)
+            {
+                if (Policy::fenceOnZero)
+                {
+                    acquireAll(strong);
+                }
+                destroyObject(this);
+                releaseWeak();
+            }
+        }
+
+        void releaseWeak()
+        {
+            if (isImmortal(weak))
+            {
+                return;
+            }
+            if (weak.fetch_sub(1, Policy::decrementOrder) == 1)
+            {
+                if (Policy::fenceOnZero)
+                {
+                    acquireAll(weak);
+                }
+                destroyBlock(this);
+            }
+        }
+
+        // Adds Immortal to both counts (once, however many threads try): the object and the block are never freed.
+        void makeImmortal()
+        {
+            for (std::atomic<typename Policy::Count>* counter : { &strong, &weak })
+            {
+                typename Policy::Count count = counter->load(std::memory_order_relaxed);
+                while (count < Immortal && !counter->compare_exchange_weak(count, count + Immortal, std::memory_order_relaxed))
+                {
+                }
+            }
+        }
+
+        // The last (release) decrement got to zero: see everything the other releases published.
+        static void acquireAll(const std::atomic<typename Policy::Count>& counter)
+        {
+#if TUNED_PTR_TSAN
+            counter.load(std::memory_order_acquire);    // TSan doesn't understand standalone fences. Reading our own zero back
+                                                        // with acquire gives the same guarantee, in a form it does understand.
+#else
+            (void)counter;
+            std::atomic_thread_fence(std::memory_order_acquire);
+#endif
+        }
+
+        // weak_ptr::lock: add a strong reference, but only if there still is one.
+        bool tryAddStrong()
+        {
+            typename Policy::Count count = strong.load(std::memory_order_relaxed);
+            if (Policy::immortals && count >= Immortal)
+            {
+                return true;
+            }
+            while (count != 0)
+            {
+                if (strong.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    // shared_ptr<T>(new T, deleter): the block holds the pointer and the deleter.
+    template<class T, class Deleter, class Policy>
+    struct PointerBlock : ControlBlock<Policy>
+    {
+        T* object;
+        [[no_unique_address]] Deleter deleter;
+
+        PointerBlock(T* object, Deleter deleter) : object(object), deleter(std::move(deleter))
+        {
+            this->destroyObject = [](ControlBlock<Policy>* block)
+            {
+                PointerBlock* me = static_cast<PointerBlock*>(block);
+                me->deleter(me->object);
+            };
+            this->destroyBlock = [](ControlBlock<Policy>* block) { delete static_cast<PointerBlock*>(block); };
+        }
+    };
+
+    // makeTunedShared: the object lives inside the block. Padded puts it on its own cache line.
+    template<class T, class Policy, bool Padded>
+    struct alignas(Padded ? CacheLineSize : alignof(ControlBlock<Policy>)) InlineBlock : ControlBlock<Policy>
+    {
+        alignas(Padded ? CacheLineSize : alignof(T)) unsigned char storage[sizeof(T)];
+
+        T* value() { return reinterpret_cast<T*>(storage); }
+
+        template<class... Args>
+        explicit InlineBlock(Args&&... args)
+        {
+            new (storage) T(std::forward<Args>(args)...);
+            this->destroyObject = [](ControlBlock<Policy>* block) { static_cast<InlineBlock*>(block)->value()->~T(); };
+            this->destroyBlock = [](ControlBlock<Policy>* block) { delete static_cast<InlineBlock*>(block); };
+        }
+    };
+}
+
+
+template<class T, class Deleter = std::default_delete<T>>
+class TunedUniquePtr
+{
+public:
+    TunedUniquePtr() = default;
+    TunedUniquePtr(std::nullptr_t) {}
+    explicit TunedUniquePtr(T* object) : object(object) {}
+    TunedUniquePtr(T* object, Deleter deleter) : object(object), deleter(std::move(deleter)) {}
+
+    TunedUniquePtr(TunedUniquePtr&& other) noexcept : object(other.release()), deleter(std::move(other.deleter)) {}
+
+    template<class U, class OtherDeleter, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    TunedUniquePtr(TunedUniquePtr<U, OtherDeleter>&& other) noexcept : deleter(std::move(other.get_deleter()))
+    {
+        object = other.release();
+    }
+
+    TunedUniquePtr& operator=(TunedUniquePtr&& other) noexcept
+    {
+        T* taken = other.release();     // Take it first: other might live inside the object we're about to delete.
+        Deleter takenDeleter = std::move(other.deleter);
+        reset(taken);
+        deleter = std::move(takenDeleter);
+        return *this;
+    }
+
+    TunedUniquePtr(const TunedUniquePtr&) = delete;
+    TunedUniquePtr& operator=(const TunedUniquePtr&) = delete;
+
+    ~TunedUniquePtr()
+    {
+        reset();
+    }
+
+    void reset(T* replacement = nullptr)
+    {
+        T* old = object;
+        object = replacement;
+        if (old != nullptr)
+        {
+            deleter(old);
+        }
+    }
+
+    T* release()
+    {
+        T* old = object;
+        object = nullptr;
+        return old;
+    }
+
+    void swap(TunedUniquePtr& other) noexcept
+    {
+        std::swap(object, other.object);
+        std::swap(deleter, other.deleter);
+    }
+
+    T* get() const { return object; }
+    T& operator*() const { return *object; }
+    T* operator->() const { return object; }
+    explicit operator bool() const { return object != nullptr; }
+    bool operator==(std::nullptr_t) const { return object == nullptr; }
+    Deleter& get_deleter() { return deleter; }
+
+private:
+    T* object = nullptr;
+    [[no_unique_address]] Deleter deleter;
+};
+
+
+template<class T, class Policy>
+class TunedWeakPtr;
+
+
+template<class T, class Policy = DefaultRefCountPolicy>
+class TunedSharedPtr
+{
+    typedef tuned_detail::ControlBlock<Policy> Block;
+
+public:
+    TunedSharedPtr() = default;
+    TunedSharedPtr(std::nullptr_t) {}
+
+    template<class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    explicit TunedSharedPtr(U* pointer) : TunedSharedPtr(pointer, std::default_delete<U>()) {}
+
+    template<class U, class Deleter, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    TunedSharedPtr(U* pointer, Deleter deleter)
+    {
+        try
+        {
+            block = new tuned_detail::PointerBlock<U, Deleter, Policy>(pointer, deleter);
+        }
+        catch (...)
+        {
+            deleter(pointer);   // Like std: if we can't make the block, the object is deleted, not leaked.
+            throw;
+        }
+        object = pointer;
+    }
+
+    template<class U, class Deleter, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    TunedSharedPtr(TunedUniquePtr<U, Deleter>&& unique)
+    {
+        if (unique != nullptr)
+        {
+            block = new tuned_detail::PointerBlock<U, Deleter, Policy>(unique.get(), unique.get_deleter());
+            object = unique.release();
+        }
+    }
+
+    // The aliasing constructor: shares owner's counts, points at something else (see main.cpp's Mojo Jojo).
+    template<class U>
+    TunedSharedPtr(const TunedSharedPtr<U, Policy>& owner, T* pointer) : object(pointer), block(owner.block)
+    {
+        if (block != nullptr)
+        {
+            block->addStrong();
+        }
+    }
+
+    TunedSharedPtr(const TunedSharedPtr& other) : object(other.object), block(other.block)
+    {
+        if (block != nullptr)
+        {
+            block->addStrong();
+        }
+    }
+
+    template<class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    TunedSharedPtr(const TunedSharedPtr<U, Policy>& other) : object(other.object), block(other.block)
+    {
+        if (block != nullptr)
+        {
+            block->addStrong();
+        }
+    }
+
+    TunedSharedPtr(TunedSharedPtr&& other) noexcept : object(std::exchange(other.object, nullptr)), block(std::exchange(other.block, nullptr)) {}
+
+    template<class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    TunedSharedPtr(TunedSharedPtr<U, Policy>&& other) noexcept : object(std::exchange(other.object, nullptr)), block(std::exchange(other.block, nullptr)) {}
+
+    // Like std: throws std::bad_weak_ptr if the object is already gone.
+    explicit TunedSharedPtr(const TunedWeakPtr<T, Policy>& weak)
+    {
+        if (weak.block == nullptr || !weak.block->tryAddStrong())
+        {
+            throw std::bad_weak_ptr();
+        }
+        object = weak.object;
+        block = weak.block;
+    }
+
+    TunedSharedPtr& operator=(TunedSharedPtr other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~TunedSharedPtr()
+    {
+        if (block != nullptr)
+        {
+            block->releaseStrong();
+        }
+    }
+
+    void reset()
+    {
+        TunedSharedPtr().swap(*this);
+    }
+
+    template<class U>
+    void reset(U* pointer)
+    {
+        TunedSharedPtr(pointer).swap(*this);
+    }
+
+    void swap(TunedSharedPtr& other) noexcept
+    {
+        std::swap(object, other.object);
+        std::swap(block, other.block);
+    }
+
+    T* get() const { return object; }
+    T& operator*() const { return *object; }
+    T* operator->() const { return object; }
+    explicit operator bool() const { return object != nullptr; }
+    bool operator==(std::nullptr_t) const { return object == nullptr; }
+    long use_count() const { return block == nullptr ? 0 : static_cast<long>(block->strong.load(std::memory_order_relaxed)); }
+
+    // Only with a policy that allows it (ImmortalRefCountPolicy). use_count() is meaningless afterwards, just very big.
+    void makeImmortal() const
+    {
+        static_assert(Policy::immortals, "makeImmortal needs a policy with immortals = true");
+        if (block != nullptr)
+        {
+            block->makeImmortal();
+        }
+    }
+
+    bool immortal() const { return block != nullptr && Block::isImmortal(block->strong); }
+
+private:
+    template<class U, class P>
+    friend class TunedSharedPtr;
+    template<class U, class P>
+    friend class TunedWeakPtr;
+    template<class U, class P, class... Args>
+    friend TunedSharedPtr<U, P> makeTunedShared(Args&&... args);
+
+    T* object = nullptr;
+    Block* block = nullptr;
+
+    struct AdoptBlock {};       // (Tells this constructor apart from the public (pointer, deleter) one)
+    TunedSharedPtr(T* object, Block* block, AdoptBlock) : object(object), block(block) {}
+};
+
+
+template<class T, class Policy = DefaultRefCountPolicy>
+class TunedWeakPtr
+{
+    typedef tuned_detail::ControlBlock<Policy> Block;
+
+public:
+    TunedWeakPtr() = default;
+
+    template<class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    TunedWeakPtr(const TunedSharedPtr<U, Policy>& shared) : object(shared.object), block(shared.block)
+    {
+        if (block != nullptr)
+        {
+            block->addWeak();
+        }
+    }
+
+    TunedWeakPtr(const TunedWeakPtr& other) : object(other.object), block(other.block)
+    {
+        if (block != nullptr)
+        {
+            block->addWeak();
+        }
+    }
+
+    TunedWeakPtr(TunedWeakPtr&& other) noexcept : object(std::exchange(other.object, nullptr)), block(std::exchange(other.block, nullptr)) {}
+
+    TunedWeakPtr& operator=(TunedWeakPtr other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~TunedWeakPtr()
+    {
+        if (block != nullptr)
+        {
+            block->releaseWeak();
+        }
+    }
+
+    // A shared pointer if the object still exists, otherwise an empty one.
+    TunedSharedPtr<T, Policy> lock() const
+    {
+        if (block != nullptr && block->tryAddStrong())
+        {
+            return TunedSharedPtr<T, Policy>(object, block, typename TunedSharedPtr<T, Policy>::AdoptBlock());
+        }
+        return TunedSharedPtr<T, Policy>();
+    }
+
+    bool expired() const { return use_count() == 0; }
+    long use_count() const { return block == nullptr ? 0 : static_cast<long>(block->strong.load(std::memory_order_relaxed)); }
+
+    void reset()
+    {
+        TunedWeakPtr().swap(*this);
+    }
+
+    void swap(TunedWeakPtr& other) noexcept
+    {
+        std::swap(object, other.object);
+        std::swap(block, other.block);
+    }
+
+private:
+    template<class U, class P>
+    friend class TunedSharedPtr;
+
+    T* object = nullptr;
+    Block* block = nullptr;
+};
+
+
+template<class T, class Policy = DefaultRefCountPolicy, class... Args>
+TunedSharedPtr<T, Policy> makeTunedShared(Args&&... args)
+{
+    if constexpr (Policy::placement == ControlBlockPlacement::Separate)
+    {
+        return TunedSharedPtr<T, Policy>(new T(std::forward<Args>(args)...));
+    }
+    else
+    {
+        typedef tuned_detail::InlineBlock<T, Policy, Policy::placement == ControlBlockPlacement::Padded> Block;
+        Block* block = new Block(std::forward<Args>(args)...);
+        return TunedSharedPtr<T, Policy>(block->value(), block, typename TunedSharedPtr<T, Policy>::AdoptBlock());
+    }
+}
+
+
+template<class T, class... Args>
+TunedUniquePtr<T> makeTunedUnique(Args&&... args)
+{
+    return TunedUniquePtr<T>(new T(std::forward<Args>(args)...));
+}
@@ -0,0 +1,122 @@
+/*
+Weak Collections
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// After Fredzilla's scope ends, weakPtr.use_count() is 0, but weakPtr still holds on to the control block.
+// And if Fredzilla came from make_shared, the control block and Fredzilla are ONE allocation: his destructor has run,
+// but none of his memory goes back until the last weak_ptr lets go.
+// A big std::vector<std::weak_ptr<Person>> that nobody cleans up keeps every dead person's memory forever.
+//
+// WeakCollection cleans up as it goes. Every add() also checks a few entries (compactBudget, 4 by default)
+// and drops the expired ones, so no single call ever does a big scan, but the dead can't pile up either:
+// as long as you keep adding, the collection only ever holds about (live + 1/compactBudget of what was added recently) entries.
+//
+// Dropping is done by moving the last entry into the hole, so the order of entries is NOT kept.
+
+template<class T>
+class WeakCollection
+{
+public:
+    explicit WeakCollection(std::size_t compactBudget = 4) : compactBudget(compactBudget) {}
+
+    void add(const std::shared_ptr<T>& object)
+    {
+        entries.push_back(object);
+        compactStep(compactBudget);
+    }
+
+    // Checks up to `budget` entries (carrying on from where the last step stopped) and drops the expired ones.
+    // Returns how many it dropped.
+    std::size_t compactStep(std::size_t budget)
+    {
+        std::size_t dropped = 0;
+        for (std::size_t checked = 0; checked < budget && !entries.empty(); checked++)
+        {
+            if (cursor >= entries.size())
+            {
+                cursor = 0;
+            }
+            if (entries[cursor].expired())
+            {
+                dropAt(cursor);     // Something new moved into cursor, so check the same spot again next time around.
+                dropped++;
+            }
+            else
+            {
+                cursor++;
+            }
+        }
+        return dropped;
+    }
+
+    // Drops every expired entry right now, in one pass over all of them.
+    // (Not compactStep(size()): once the cursor wraps around, swapping entries in from the back can skip some)
+    std::size_t compact()
+    {
+        std::size_t before = entries.size();
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const std::weak_ptr<T>& entry) { return entry.expired(); }), entries.end());
+        std::size_t dropped = before - entries.size();
+        reclaimedCount += dropped;
+        cursor = 0;
+        return dropped;
+    }
+
+    // Calls fn(T&) on everyone still alive.
+    template<class Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (const std::weak_ptr<T>& entry : entries)
+        {
+            std::shared_ptr<T> object = entry.lock();
+            if (object != nullptr)
+            {
+                fn(*object);
+            }
+        }
+    }
+
+    // How many entries we're holding, including dead ones not cleaned up yet.
+    std::size_t size() const { return entries.size(); }
+
+    // How many dead entries have been dropped so far (each one let go of a control block).
+    std::size_t reclaimed() const { return reclaimedCount; }
+
+    // Gives back vector memory left over from when the collection was bigger.
+    void shrinkToFit() { entries.shrink_to_fit(); }
+
+private:
+    std::vector<std::weak_ptr<T>> entries;
+    std::size_t compactBudget;
+    std::size_t cursor = 0;
+    std::size_t reclaimedCount = 0;
+
+    void dropAt(std::size_t index)
+    {
+        if (index + 1 != entries.size())
+        {
+            entries[index] = std::move(entries.back());
+        }
+        entries.pop_back();
+        reclaimedCount++;
+    }
+};
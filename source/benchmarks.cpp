@@ -0,0 +1,2137 @@
+/*
+Smart Pointer Benchmarks
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// This is a separate program from main.cpp, it runs the same ownership patterns from the tutorial
+// many times over (without printing or waiting for input) so we can time them.
+//
+//     benchmarks                       runs every scenario
+//     benchmarks --list                prints the scenario names
+//     benchmarks --scenario NAME       runs only the scenarios whose names contain NAME
+//     benchmarks --scale 0.1           runs each scenario 10x fewer times (used for PGO training)
+//     benchmarks --stats json|csv      also reports allocations and lifetimes per scenario (needs make STATS=1)
+//     benchmarks --repeat 11           runs each scenario 11 times and reports the median, MAD and 95% confidence interval
+//     benchmarks --save FILE           (needs --repeat 2+) stores the medians as a baseline
+//     benchmarks --check FILE          (needs --repeat 2+) compares against a baseline, exits with 1 if anything regressed
+//     benchmarks --threshold 0.05      how much slower counts as a regression for --check (default 5%)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../header/arena.h"
+#include "../header/batch_lock.h"
+#include "../header/bench_stats.h"
+#include "../header/borrowed_ptr.h"
+#include "../header/compressed_ptr.h"
+#include "../header/coroutine_lifetime.h"
+#include "../header/deferred_ref.h"
+#include "../header/destruction_scheduler.h"
+#include "../header/expiry_notify.h"
+#include "../header/incremental_release.h"
+#include "../header/packed_pair.h"
+#include "../header/pair.h"
+#include "../header/parallel_forest.h"
+#include "../header/parallel_teardown.h"
+#include "../header/perf_counters.h"
+#include "../header/pin_scope.h"
+#include "../header/placed_shared_ptr.h"
+#include "../header/pointer_switch.h"
+#include "../header/shared_slice.h"
+#include "../header/tagged_ptr.h"
+#include "../header/weak_collection.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../header/remote_ptr.h"
+#include "../header/shm_shared_ptr.h"
+#endif
+
+#define SCOPE_STATS_IMPLEMENTATION      // This program owns the global operator new when stats are compiled in (make STATS=1).
+#include "../header/scope_stats.h"
+
+
+// The same three Person classes from main.cpp, minus the printing.
+struct RawPerson
+{
+    std::string name;
+    RawPerson* parent = nullptr;
+
+    RawPerson(std::string name) : name(std::move(name)) {}
+    ~RawPerson()
+    {
+        delete parent;
+    }
+};
+
+struct UniquePerson
+{
+    std::string name;
+    std::unique_ptr<UniquePerson> parent;
+
+    UniquePerson(std::string name) : name(std::move(name)) {}
+};
+
+// Runs the destructor but leaves the memory to the arena it came from.
+template<class T>
+struct ArenaDelete
+{
+    void operator()(T* object) const { object->~T(); }
+};
+
+struct SharedPerson
+{
+    std::string name;
+    std::shared_ptr<SharedPerson> parent;
+
+    SharedPerson(std::string name) : name(std::move(name)) {}
+};
+
+// Same as SharedPerson, but hands its parent to ParallelTeardown instead of releasing it inline.
+struct TeardownPerson
+{
+    std::string name;
+    std::shared_ptr<TeardownPerson> parent;
+
+    TeardownPerson(std::string name) : name(std::move(name)) {}
+    ~TeardownPerson()
+    {
+        ParallelTeardown::defer(std::move(parent));
+    }
+};
+
+// Same again, for an IncrementalReleaser.
+struct IncrementalPerson
+{
+    std::string name;
+    std::shared_ptr<IncrementalPerson> parent;
+
+    IncrementalPerson(std::string name) : name(std::move(name)) {}
+    ~IncrementalPerson()
+    {
+        IncrementalReleaser::defer(std::move(parent));
+    }
+};
+
+
+// A little request handling service: users (each with a manager) live in a registry,
+// every request looks one up, passes it around by value, and builds a response that points back at the user.
+// Once with shared_ptr, once with deferred reference counting (header/deferred_ref.h).
+struct StdUser
+{
+    std::string name;
+    std::shared_ptr<StdUser> manager;
+
+    StdUser(std::string name) : name(std::move(name)) {}
+};
+
+struct StdResponse
+{
+    std::shared_ptr<StdUser> user;
+    std::size_t bytes = 0;
+};
+
+struct DeferredUser
+{
+    std::string name;
+    HeapRef<DeferredUser> manager;
+
+    DeferredUser(std::string name) : name(std::move(name)) {}
+};
+
+struct DeferredResponse
+{
+    HeapRef<DeferredUser> user;
+    std::size_t bytes = 0;
+};
+
+
+// Something with an expensive destructor: it checks its whole 4 KB buffer on the way out (think flushing a file or a GPU resource).
+struct Texture
+{
+    std::vector<unsigned char> pixels;
+    std::shared_ptr<Texture> material;     // Has to go after us.
+
+    Texture() : pixels(4096, 1) {}
+
+    ~Texture()
+    {
+        unsigned sum = 0;
+        for (unsigned char pixel : pixels)
+        {
+            sum += pixel;
+        }
+        textureChecksum += sum;
+    }
+
+    static inline std::uint64_t textureChecksum = 0;
+};
+
+// Stops the optimizer from deleting work whose result we never look at.
+template<class T>
+inline void keep(T const& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+
+// How much memory the process really has in RAM right now (0 where we can't tell).
+inline std::uint64_t residentBytes()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    std::uint64_t size = 0;
+    std::uint64_t resident = 0;
+    if (statm >> size >> resident)
+    {
+        return resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));     // statm counts pages.
+    }
+    return 0;
+#endif
+}
+
+// How much it grew since `before`. 0 if it shrank (freed memory going back to the OS in the meantime).
+inline std::uint64_t residentGrowth(std::uint64_t before)
+{
+    std::uint64_t now = residentBytes();
+    return now > before ? now - before : 0;
+}
+
+
+// A shared_ptr that counts its reference count traffic: every copy (+1) and every release of a non-null pointer (-1).
+// Moves don't touch the count, so they aren't counted either.
+std::uint64_t refcountOperations = 0;
+
+template<class T>
+class CountedShared : public std::shared_ptr<T>
+{
+public:
+    CountedShared() = default;
+    CountedShared(std::shared_ptr<T>&& pointer) : std::shared_ptr<T>(std::move(pointer))
+    {
+        if (*this)
+        {
+            refcountOperations++;       // Comes from a lock() or a copy someone else made.
+        }
+    }
+    CountedShared(const CountedShared& other) : std::shared_ptr<T>(other)
+    {
+        if (*this)
+        {
+            refcountOperations++;
+        }
+    }
+    CountedShared(CountedShared&& other) noexcept = default;
+    CountedShared& operator=(CountedShared&& other) noexcept
+    {
+        if (*this)
+        {
+            refcountOperations++;
+        }
+        std::shared_ptr<T>::operator=(std::move(other));
+        return *this;
+    }
+    CountedShared& operator=(const CountedShared&) = delete;
+    ~CountedShared()
+    {
+        if (*this)
+        {
+            refcountOperations++;
+        }
+    }
+};
+
+
+// A scenario is a name, how many operations one run does, and the code to run.
+// Scenarios that only want to time part of the work (like tearing down a forest, not building it)
+// can do the rest in prepare, which runs before every timed run and isn't timed itself.
+struct Scenario
+{
+    std::string name;
+    std::uint64_t ops;
+    std::function<void(std::uint64_t)> run;
+    std::function<void(std::uint64_t)> prepare = nullptr;
+    std::function<void(std::uint64_t)> report = nullptr;   // Prints what the scenario found, once, after the timed runs (so not timed).
+};
+
+// Three ways to hand the Professor to a function that only wants to read his name.
+// noinline keeps the compiler from seeing through the call and skipping the copy.
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE __declspec(noinline)
+#endif
+
+BENCH_NOINLINE std::size_t nameLengthByValue(std::shared_ptr<SharedPerson> person) { return person->name.size(); }
+BENCH_NOINLINE std::size_t nameLengthByReference(const std::shared_ptr<SharedPerson>& person) { return person->name.size(); }
+BENCH_NOINLINE std::size_t nameLengthBorrowed(borrowed_ptr<SharedPerson> person) { return person->name.size(); }
+
+// The steps of a request, each taking what it needs by value (like most handler code does).
+BENCH_NOINLINE bool authorize(std::shared_ptr<StdUser> user)
+{
+    std::shared_ptr<StdUser> manager = user->manager;
+    return manager == nullptr || manager->name.size() < user->name.size() + 16;
+}
+
+BENCH_NOINLINE std::size_t render(std::shared_ptr<StdResponse> response)
+{
+    std::shared_ptr<StdUser> user = response->user;
+    return response->bytes + user->name.size();
+}
+
+BENCH_NOINLINE bool authorize(LocalRef<DeferredUser> user)
+{
+    LocalRef<DeferredUser> manager = user->manager;
+    return manager == nullptr || manager->name.size() < user->name.size() + 16;
+}
+
+BENCH_NOINLINE std::size_t render(LocalRef<DeferredResponse> response)
+{
+    LocalRef<DeferredUser> user = response->user;
+    return response->bytes + user->name.size();
+}
+
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+// Request handlers, the usual way: hold a shared_ptr the whole time, and pass it by value to every step.
+Task<std::size_t> readNameCopied(EventLoop& loop, CountedShared<SharedPerson> person)
+{
+    co_await loop.yield();
+    co_return person->name.size();
+}
+
+Task<void> handleRequestCopied(EventLoop& loop, CountedShared<SharedPerson> person, std::size_t& total)
+{
+    for (int step = 0; step < 3; step++)
+    {
+        total += co_await readNameCopied(loop, person);
+    }
+}
+
+// The same handler with a weak_ptr while waiting to start, and Owned moving in and out of each step.
+Task<Owned<SharedPerson, CountedShared<SharedPerson>>> readNameOwned(EventLoop& loop, Owned<SharedPerson, CountedShared<SharedPerson>> person, std::size_t& total)
+{
+    co_await loop.yield();
+    total += person->name.size();
+    co_return std::move(person);
+}
+
+Task<void> handleRequestOwned(EventLoop& loop, std::weak_ptr<SharedPerson> weak, std::size_t& total)
+{
+    Owned<SharedPerson, CountedShared<SharedPerson>> person(CountedShared<SharedPerson>(co_await loop.lock(weak)));
+    if (!person)
+    {
+        co_return;
+    }
+    for (int step = 0; step < 3; step++)
+    {
+        person = co_await readNameOwned(loop, std::move(person), total);
+    }
+}
+
+#endif
+
+// The same five ownership patterns for each kind of pointer in header/pointer_switch.h ("matrix/<kind>/<pattern>").
+// copy-contended goes first on purpose: libstdc++ skips the atomics entirely until the program starts its first thread,
+// so without it a filtered run would compare non-atomic std counts against atomic tuned ones.
+template<class Pointers>
+struct MatrixPerson
+{
+    std::string name;
+    typename Pointers::template Unique<MatrixPerson> parent;
+
+    MatrixPerson(std::string name) : name(std::move(name)) {}
+};
+
+template<class Pointers>
+void addPointerMatrix(std::vector<Scenario>& scenarios, const std::string& kind)
+{
+    typedef MatrixPerson<Pointers> Person;
+    typedef typename Pointers::template Unique<Person> Unique;
+    typedef typename Pointers::template Shared<Person> Shared;
+    typedef typename Pointers::template Weak<Person> Weak;
+
+    scenarios.push_back({ "matrix/" + kind + "/copy-contended", 10000000, [](std::uint64_t ops)
+    {
+        Shared professor = Pointers::template makeShared<Person>("Professor");
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&professor, ops]()
+            {
+                for (std::uint64_t i = 0; i < ops / 4; i++)
+                {
+                    Shared copy = professor;
+                    keep(copy);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    } });
+    scenarios.push_back({ "matrix/" + kind + "/unique-chain", 1000000, [](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            Unique joe = Pointers::template makeUnique<Person>("Joe the third");
+            joe->parent = Pointers::template makeUnique<Person>("Joe the second");
+            joe->parent->parent = Pointers::template makeUnique<Person>("Joe the first");
+            keep(joe);
+        }
+    } });
+    scenarios.push_back({ "matrix/" + kind + "/make-shared", 1000000, [](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            Shared professor = Pointers::template makeShared<Person>("Professor");
+            keep(professor);
+        }
+    } });
+    scenarios.push_back({ "matrix/" + kind + "/copy", 10000000, [](std::uint64_t ops)
+    {
+        Shared professor = Pointers::template makeShared<Person>("Professor");
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            Shared copy = professor;
+            keep(copy);
+        }
+    } });
+    scenarios.push_back({ "matrix/" + kind + "/weak-lock", 10000000, [](std::uint64_t ops)
+    {
+        Shared fredzilla = Pointers::template makeShared<Person>("Fredzilla");
+        Weak weakPtr = fredzilla;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            Shared temp = weakPtr.lock();
+            keep(temp);
+        }
+    } });
+}
+
+// Ten people, and every copy is of one of them in turn: nine are Professors who live forever, one isn't.
+// So 90% of copies go to objects that could be immortal. With Mark, they are (ImmortalRefCountPolicy only).
+// (copy-contended goes first for the same reason as in the matrix above)
+template<class Pointers, bool Mark>
+void addImmortalWorkload(std::vector<Scenario>& scenarios, const std::string& kind)
+{
+    typedef MatrixPerson<Pointers> Person;
+    typedef typename Pointers::template Shared<Person> Shared;
+
+    auto makePeople = []()
+    {
+        std::vector<Shared> people;
+        for (int i = 0; i < 10; i++)
+        {
+            people.push_back(Pointers::template makeShared<Person>(i == 0 ? "Buttercup" : "Professor"));
+            if constexpr (Mark)
+            {
+                if (i != 0)
+                {
+                    people.back().makeImmortal();
+                }
+            }
+        }
+        return people;
+    };
+
+    scenarios.push_back({ "immortal/" + kind + "/copy-contended", 10000000, [makePeople](std::uint64_t ops)
+    {
+        std::vector<Shared> people = makePeople();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&people, ops, t]()
+            {
+                for (std::uint64_t i = 0; i < ops / 4; i++)
+                {
+                    Shared copy = people[(i + t) % 10];
+                    keep(copy);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    } });
+    scenarios.push_back({ "immortal/" + kind + "/copy", 10000000, [makePeople](std::uint64_t ops)
+    {
+        std::vector<Shared> people = makePeople();
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            Shared copy = people[i % 10];
+            keep(copy);
+        }
+    } });
+}
+
+#ifndef _WIN32
+
+// main.cpp's Person, for a shared memory segment: no std::string (its characters would be in one process's heap),
+// and the parent is a ShmRef.
+struct ShmPerson
+{
+    static constexpr std::uint32_t ShmTypeId = 1;
+
+    char name[32];
+    ShmRef<ShmPerson> parent;
+
+    ShmPerson(const char* text)
+    {
+        std::strncpy(name, text, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+    }
+};
+
+// Forks `processes` workers that each run work(ops / processes) on the segment, waits for them, and reaps them.
+// The workers just _exit when they're done: their references are cleaned up the same way as a crashed worker's.
+void runWorkers(ShmSegment& segment, unsigned processes, std::uint64_t ops, const std::function<void(std::uint64_t)>& work)
+{
+    std::vector<pid_t> workers;
+    for (unsigned p = 0; p < processes; p++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            segment.reattachAfterFork();
+            work(ops / processes);
+            _exit(0);
+        }
+        workers.push_back(pid);
+    }
+    for (pid_t pid : workers)
+    {
+        waitpid(pid, nullptr, 0);
+    }
+    segment.reapDeadProcesses();
+}
+
+// The Professor in a shared memory segment, read by 2 to 16 worker processes. Ops are pointer copies (and a read).
+// "shm/process-copy-N" copies a ShmSharedPtr: counted inside the worker, the shared count isn't touched.
+// "shm/stored-copy-N" copies a ShmRef instead, which counts every copy in the segment, like a plain cross-process count would.
+// "shm/crash-cleanup" has a worker take references and kill -9 itself, over and over (ops are crashes),
+// then checks that reaping put everything back. Afterwards one more (untimed) run counts what was left and prints it.
+void addShmScenarios(std::vector<Scenario>& scenarios)
+{
+    std::string name = "/smartpointers-bench-" + std::to_string(getpid());
+
+    for (unsigned processes : { 2u, 4u, 8u, 16u })
+    {
+        std::string suffix = "-" + std::to_string(processes);
+        scenarios.push_back({ "shm/process-copy" + suffix, 10000000, [name, processes](std::uint64_t ops)
+        {
+            ShmSegment segment(name, 1 << 20, 1024);
+            ShmSegment::Scope use(segment);
+            ShmSharedPtr<ShmPerson> professor = makeShmShared<ShmPerson>("Professor");
+            runWorkers(segment, processes, ops, [&professor](std::uint64_t count)
+            {
+                std::size_t total = 0;
+                for (std::uint64_t i = 0; i < count; i++)
+                {
+                    ShmSharedPtr<ShmPerson> copy = professor;
+                    total += copy->name[0];
+                }
+                keep(total);
+            });
+            professor.reset();
+            ShmSegment::remove(name);
+        } });
+        scenarios.push_back({ "shm/stored-copy" + suffix, 10000000, [name, processes](std::uint64_t ops)
+        {
+            ShmSegment segment(name, 1 << 20, 1024);
+            ShmSegment::Scope use(segment);
+            ShmSharedPtr<ShmPerson> professor = makeShmShared<ShmPerson>("Professor");
+            runWorkers(segment, processes, ops, [&professor](std::uint64_t count)
+            {
+                std::size_t total = 0;
+                for (std::uint64_t i = 0; i < count; i++)
+                {
+                    ShmRef<ShmPerson> copy = professor;
+                    total += copy->name[0];
+                }
+                keep(total);
+            });
+            professor.reset();
+            ShmSegment::remove(name);
+        } });
+    }
+
+    auto crashCleanup = [name](std::uint64_t ops, bool print)
+    {
+        ShmSegment segment(name, 1 << 20, 1024);
+        ShmSegment::Scope use(segment);
+        ShmSharedPtr<ShmPerson> professor = makeShmShared<ShmPerson>("Professor");
+        segment.setRoot(0, professor);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            runWorkers(segment, 1, 1, [&segment](std::uint64_t)
+            {
+                ShmSharedPtr<ShmPerson> found = segment.root<ShmPerson>(0);
+                ShmWeakPtr<ShmPerson> watcher = found;
+                ShmSharedPtr<ShmPerson> child = makeShmShared<ShmPerson>("Buttercup");
+                child->parent = found;
+                std::vector<ShmSharedPtr<ShmPerson>> copies(10, child);
+                kill(getpid(), SIGKILL);    // Dies holding all of that.
+            });
+        }
+        std::size_t beforeRelease = print ? segment.liveObjects() : 0;
+        segment.setRoot(0, ShmSharedPtr<ShmPerson>());
+        professor.reset();
+        if (print)
+        {
+            std::cout << "  live objects after " << ops << " crashes: " << beforeRelease << ", after letting go of the Professor: " << segment.liveObjects() << std::endl;
+        }
+        ShmSegment::remove(name);
+    };
+    scenarios.push_back({ "shm/crash-cleanup", 200, [crashCleanup](std::uint64_t ops) { crashCleanup(ops, false); }, nullptr,
+        [crashCleanup](std::uint64_t ops) { crashCleanup(ops, true); } });
+}
+
+// The Professor owned by a RemoteOwner (its own thread here, talking over a real Unix socket, like another process would).
+// Ops are copies of a pointer to him, made and destroyed.
+// "remote/weighted-copy" is RemotePtr: weight splitting, with batched give backs.
+// "remote/naive-copy" is NaiveRemotePtr: a round trip to the owner per copy, and a message per destruction.
+// Afterwards each prints the messages its last run took, per op and per second.
+// "remote/lease-expiry" has a client go quiet while holding the last reference (ops are clients): once its lease
+// runs out, the owner takes its weight back and the object is gone.
+template<class Pointer>
+void copyRemote(RemoteClient& client, const Pointer& professor, std::uint64_t ops)
+{
+    for (std::uint64_t i = 0; i < ops; i++)
+    {
+        Pointer copy = professor;
+        keep(copy.remoteId());
+    }
+    client.flush();
+}
+
+void addRemoteScenarios(std::vector<Scenario>& scenarios)
+{
+    std::string path = "/tmp/smartpointers-bench-" + std::to_string(getpid()) + ".sock";
+
+    // What the last run's client sent, and how long its copies took.
+    struct Messages
+    {
+        RemoteClient::Stats stats;
+        std::chrono::steady_clock::duration took{};
+    };
+    auto printMessages = [](const char* name, const std::shared_ptr<Messages>& messages)
+    {
+        return [name, messages](std::uint64_t ops)
+        {
+            double seconds = std::chrono::duration<double>(messages->took).count();
+            std::cout << "  " << name << ": " << static_cast<double>(messages->stats.messages) / ops << " messages/op, "
+                << messages->stats.roundTrips << " round trips, " << static_cast<std::uint64_t>(messages->stats.messages / seconds) << " messages/s" << std::endl;
+        };
+    };
+
+    std::shared_ptr<Messages> weighted = std::make_shared<Messages>();
+    scenarios.push_back({ "remote/weighted-copy", 2000000, [path, weighted](std::uint64_t ops)
+    {
+        RemoteOwner owner(path);
+        std::uint64_t id = owner.publish(std::make_shared<SharedPerson>("Professor"));
+        RemoteClient client(path);
+        RemotePtr<SharedPerson> professor = client.acquire<SharedPerson>(id);
+        client.resetStatistics();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        copyRemote(client, professor, ops);
+        weighted->took = std::chrono::steady_clock::now() - start;
+        weighted->stats = client.statistics();
+    }, nullptr, printMessages("weighted", weighted) });
+
+    std::shared_ptr<Messages> naive = std::make_shared<Messages>();
+    scenarios.push_back({ "remote/naive-copy", 50000, [path, naive](std::uint64_t ops)
+    {
+        RemoteOwner owner(path);
+        std::uint64_t id = owner.publish(std::make_shared<SharedPerson>("Professor"));
+        RemoteClient client(path);
+        NaiveRemotePtr<SharedPerson> professor = client.acquireNaive<SharedPerson>(id);
+        client.resetStatistics();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        copyRemote(client, professor, ops);
+        naive->took = std::chrono::steady_clock::now() - start;
+        naive->stats = client.statistics();
+    }, nullptr, printMessages("naive", naive) });
+
+    // What the last run saw.
+    struct Leases
+    {
+        std::size_t reclaimed = 0;
+        std::size_t noticed = 0;
+        std::uint64_t expired = 0;
+    };
+    std::shared_ptr<Leases> leases = std::make_shared<Leases>();
+    scenarios.push_back({ "remote/lease-expiry", 5, [path, leases](std::uint64_t ops)
+    {
+        RemoteOwner owner(path, std::chrono::milliseconds(20));
+        std::size_t reclaimed = 0;
+        std::size_t noticed = 0;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::uint64_t id = owner.publish(std::make_shared<SharedPerson>("Buttercup"));
+            RemoteClient client(path);
+            RemotePtr<SharedPerson> buttercup = client.acquire<SharedPerson>(id);
+            RemotePtr<SharedPerson> copy = buttercup;
+            owner.unpublish(id);    // The client's pointers are all that's keeping her now.
+            std::this_thread::sleep_for(std::chrono::milliseconds(60));     // And it doesn't keepAlive().
+            reclaimed += owner.find<SharedPerson>(id) == nullptr ? 1 : 0;
+            client.flush();
+            noticed += client.leaseLost() ? 1 : 0;      // Its next message finds the owner hung up.
+        }
+        leases->reclaimed = reclaimed;
+        leases->noticed = noticed;
+        leases->expired = owner.statistics().expired;
+    }, nullptr, [leases](std::uint64_t ops)
+    {
+        std::cout << "  reclaimed after the lease ran out: " << leases->reclaimed << " of " << ops << ", clients that noticed: " << leases->noticed
+                  << ", leases expired: " << leases->expired << std::endl;
+    } });
+}
+
+#endif
+
+struct SeparateBlockPolicy : DefaultRefCountPolicy
+{
+    static constexpr ControlBlockPlacement placement = ControlBlockPlacement::Separate;
+};
+
+struct PaddedBlockPolicy : DefaultRefCountPolicy
+{
+    static constexpr ControlBlockPlacement placement = ControlBlockPlacement::Padded;
+};
+
+
+std::vector<Scenario> makeScenarios()
+{
+    std::vector<Scenario> scenarios;
+
+    // tim and timothy: a raw pointer chain, deleted from the bottom.
+    scenarios.push_back({ "raw/chain", 1000000, [](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            RawPerson* tim = new RawPerson("tim");
+            tim->parent = new RawPerson("timothy");
+            keep(tim);
+            delete tim;
+        }
+    } });
+
+    // The three Joes: a unique_ptr chain that cleans itself up.
+    scenarios.push_back({ "unique/chain", 1000000, [](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::unique_ptr<UniquePerson> joe(new UniquePerson("Joe the third"));
+            joe->parent = std::unique_ptr<UniquePerson>(new UniquePerson("Joe the second"));
+            joe->parent->parent = std::unique_ptr<UniquePerson>(new UniquePerson("Joe the first"));
+            keep(joe);
+        }
+    } });
+
+    // who and what: swapping unique_ptrs is just swapping two pointers.
+    scenarios.push_back({ "unique/swap", 10000000, [](std::uint64_t ops)
+    {
+        std::unique_ptr<UniquePerson> who(new UniquePerson("who"));
+        std::unique_ptr<UniquePerson> what(new UniquePerson("what"));
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            who.swap(what);
+            keep(who);
+        }
+    } });
+
+    // The Professor shared by Blossom, Bubbles and Buttercup.
+    scenarios.push_back({ "shared/professor", 1000000, [](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            SharedPerson* blossom = new SharedPerson("Blossom");
+            SharedPerson* bubbles = new SharedPerson("Bubbles");
+            SharedPerson* buttercup = new SharedPerson("Buttercup");
+            blossom->parent = std::shared_ptr<SharedPerson>(new SharedPerson("Professor"));
+            bubbles->parent = blossom->parent;
+            buttercup->parent = bubbles->parent;
+            keep(buttercup->parent);
+            delete blossom;
+            delete bubbles;
+            delete buttercup;
+        }
+    } });
+
+    // Copying a shared_ptr is an atomic increment, destroying the copy is an atomic decrement.
+    scenarios.push_back({ "shared/copy", 10000000, [](std::uint64_t ops)
+    {
+        std::shared_ptr<SharedPerson> professor = std::make_shared<SharedPerson>("Professor");
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::shared_ptr<SharedPerson> copy = professor;
+            keep(copy);
+        }
+    } });
+
+    // Same thing, but 4 threads fight over the same reference count.
+    scenarios.push_back({ "shared/copy-contended", 10000000, [](std::uint64_t ops)
+    {
+        const unsigned threadCount = 4;
+        std::shared_ptr<SharedPerson> professor = std::make_shared<SharedPerson>("Professor");
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&professor, ops, threadCount]()
+            {
+                for (std::uint64_t i = 0; i < ops / threadCount; i++)
+                {
+                    std::shared_ptr<SharedPerson> copy = professor;
+                    keep(copy);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    } });
+
+    // Fredzilla: lock a weak_ptr while the object is still alive.
+    scenarios.push_back({ "weak/lock", 10000000, [](std::uint64_t ops)
+    {
+        std::shared_ptr<SharedPerson> fredzilla = std::make_shared<SharedPerson>("Fredzilla");
+        std::weak_ptr<SharedPerson> weakPtr = fredzilla;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::shared_ptr<SharedPerson> temp = weakPtr.lock();
+            keep(temp);
+        }
+    } });
+
+    // A request touching 256 weak references at a time, out of a million people spread all over the heap (1 in 10 dead).
+    // "lock-loop" calls lock() on each, "lock-batch" uses lockBatch, which prefetches control blocks ahead of itself.
+    // Ops are weak_ptrs locked. The people are made in prepare.
+    struct WeakBatches
+    {
+        std::vector<std::shared_ptr<SharedPerson>> people;
+        std::vector<std::weak_ptr<SharedPerson>> refs;
+    };
+    std::shared_ptr<WeakBatches> weakBatches = std::make_shared<WeakBatches>();
+    auto makeWeakBatches = [weakBatches](std::uint64_t ops)
+    {
+        if (weakBatches->refs.size() == ops)
+        {
+            return;
+        }
+        *weakBatches = WeakBatches();
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            weakBatches->people.push_back(std::make_shared<SharedPerson>("Fredzilla"));
+        }
+        std::uint64_t random = 88172645463325252ull;
+        for (std::uint64_t i = ops - 1; i > 0; i--)     // Shuffle, so neighbours in refs are nowhere near each other in memory.
+        {
+            random ^= random << 13; random ^= random >> 7; random ^= random << 17;
+            std::swap(weakBatches->people[i], weakBatches->people[random % (i + 1)]);
+        }
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            weakBatches->refs.push_back(weakBatches->people[i]);
+        }
+        for (std::uint64_t i = 0; i < ops; i += 10)
+        {
+            weakBatches->people[i].reset();
+        }
+    };
+    const std::size_t weakBatchSize = 256;
+    scenarios.push_back({ "weak/lock-loop", 1000000, [weakBatches, weakBatchSize](std::uint64_t)
+    {
+        std::vector<std::shared_ptr<SharedPerson>> live;
+        std::size_t total = 0;
+        for (std::size_t start = 0; start < weakBatches->refs.size(); start += weakBatchSize)
+        {
+            std::size_t end = std::min(start + weakBatchSize, weakBatches->refs.size());
+            live.clear();
+            for (std::size_t i = start; i < end; i++)
+            {
+                std::shared_ptr<SharedPerson> person = weakBatches->refs[i].lock();
+                if (person != nullptr)
+                {
+                    live.push_back(std::move(person));
+                }
+            }
+            total += live.size();
+        }
+        keep(total);
+    }, makeWeakBatches });
+    scenarios.push_back({ "weak/lock-batch", 1000000, [weakBatches, weakBatchSize](std::uint64_t)
+    {
+        std::vector<std::shared_ptr<SharedPerson>> live;
+        std::size_t total = 0;
+        for (std::size_t start = 0; start < weakBatches->refs.size(); start += weakBatchSize)
+        {
+            std::size_t end = std::min(start + weakBatchSize, weakBatches->refs.size());
+            live.clear();
+            total += lockBatch(weakBatches->refs.data() + start, end - start, live);
+        }
+        keep(total);
+    }, makeWeakBatches });
+
+    // An index of weak_ptrs to a million people who each live only while the next 1000 are made (all from make_shared).
+    // "collection-vector" never cleans up, "collection-compacting" is a WeakCollection checking 4 entries per add.
+    // Ops are people made and added. Afterwards one more (untimed) run prints what's left in the index and how much the resident set grew.
+    auto collectionVector = [](std::uint64_t ops, bool print)
+    {
+        std::uint64_t before = print ? residentBytes() : 0;
+        std::vector<std::shared_ptr<SharedPerson>> alive(1000);
+        std::vector<std::weak_ptr<SharedPerson>> index;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::shared_ptr<SharedPerson> person = std::make_shared<SharedPerson>("Fredzilla");
+            index.push_back(person);
+            alive[i % alive.size()] = std::move(person);
+        }
+        if (print)
+        {
+            std::cout << "  entries held: " << index.size() << ", resident growth: " << residentGrowth(before) / 1024 << " KB" << std::endl;
+        }
+    };
+    scenarios.push_back({ "weak/collection-vector", 1000000, [collectionVector](std::uint64_t ops) { collectionVector(ops, false); }, nullptr,
+        [collectionVector](std::uint64_t ops) { collectionVector(ops, true); } });
+
+    auto collectionCompacting = [](std::uint64_t ops, bool print)
+    {
+        std::uint64_t before = print ? residentBytes() : 0;
+        std::vector<std::shared_ptr<SharedPerson>> alive(1000);
+        WeakCollection<SharedPerson> index;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::shared_ptr<SharedPerson> person = std::make_shared<SharedPerson>("Fredzilla");
+            index.add(person);
+            alive[i % alive.size()] = std::move(person);
+        }
+        if (print)
+        {
+            std::cout << "  entries held: " << index.size() << " (" << index.reclaimed() << " reclaimed), resident growth: "
+                      << residentGrowth(before) / 1024 << " KB" << std::endl;
+        }
+    };
+    scenarios.push_back({ "weak/collection-compacting", 1000000, [collectionCompacting](std::uint64_t ops) { collectionCompacting(ops, false); }, nullptr,
+        [collectionCompacting](std::uint64_t ops) { collectionCompacting(ops, true); } });
+
+    // Reading a name through a shared_ptr passed by value (2 atomic ops per call), by const reference, and through a borrowed_ptr.
+    // The -contended versions do it from 4 threads at once, which is where the atomics really hurt.
+    auto borrowScenario = [](std::size_t (*read)(const std::shared_ptr<SharedPerson>&), unsigned threadCount)
+    {
+        return [read, threadCount](std::uint64_t ops)
+        {
+            std::shared_ptr<SharedPerson> professor = std::make_shared<SharedPerson>("Professor");
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < threadCount; t++)
+            {
+                threads.emplace_back([&professor, read, ops, threadCount]()
+                {
+                    std::size_t total = 0;
+                    for (std::uint64_t i = 0; i < ops / threadCount; i++)
+                    {
+                        total += read(professor);
+                    }
+                    keep(total);
+                });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+        };
+    };
+    auto byValue = [](const std::shared_ptr<SharedPerson>& owner) { return nameLengthByValue(owner); };
+    auto byReference = [](const std::shared_ptr<SharedPerson>& owner) { return nameLengthByReference(owner); };
+    auto borrowed = [](const std::shared_ptr<SharedPerson>& owner) { return nameLengthBorrowed(owner); };
+    for (unsigned threads : { 1u, 4u })
+    {
+        std::string suffix = threads == 1 ? "" : "-contended";
+        scenarios.push_back({ "borrow/shared-by-value" + suffix, 10000000, borrowScenario(byValue, threads) });
+        scenarios.push_back({ "borrow/shared-by-reference" + suffix, 10000000, borrowScenario(byReference, threads) });
+        scenarios.push_back({ "borrow/borrowed_ptr" + suffix, 10000000, borrowScenario(borrowed, threads) });
+    }
+
+    // Reading child->parent->name for 10000 children with 100 parents between them. Ops are children read.
+    // "pin/copy-each" copies the parent's shared_ptr for every read, "pin/scope-sorted" pins through a PinScope
+    // per batch of 10000 with children grouped by parent. The -shuffled versions do the same with the children in random order.
+    // Each scope scenario prints how many references it actually took, after its timed runs.
+    std::shared_ptr<std::vector<std::shared_ptr<SharedPerson>>> children = std::make_shared<std::vector<std::shared_ptr<SharedPerson>>>();
+    auto buildChildren = [children](bool shuffled)
+    {
+        return [children, shuffled](std::uint64_t)
+        {
+            std::thread([]() {}).join();    // So libstdc++ counts atomically, like it would with other threads around.
+            children->clear();
+            std::vector<std::shared_ptr<SharedPerson>> parents;
+            for (int i = 0; i < 100; i++)
+            {
+                parents.push_back(std::make_shared<SharedPerson>("Professor " + std::to_string(i)));
+            }
+            for (int i = 0; i < 10000; i++)
+            {
+                children->push_back(std::make_shared<SharedPerson>("Buttercup"));
+                children->back()->parent = parents[i / 100];
+            }
+            if (shuffled)
+            {
+                std::mt19937 random(42);
+                std::shuffle(children->begin(), children->end(), random);
+            }
+        };
+    };
+    auto copyScenario = [children](std::uint64_t ops)
+    {
+        std::size_t total = 0;
+        for (std::uint64_t done = 0; done < ops; done += children->size())
+        {
+            for (const std::shared_ptr<SharedPerson>& child : *children)
+            {
+                std::shared_ptr<SharedPerson> parent = child->parent;
+                total += parent->name.size();
+            }
+        }
+        keep(total);
+    };
+    auto pinScenario = [children](std::shared_ptr<std::size_t> references)
+    {
+        return [children, references](std::uint64_t ops)
+        {
+            std::size_t total = 0;
+            for (std::uint64_t done = 0; done < ops; done += children->size())
+            {
+                PinScope scope;
+                for (const std::shared_ptr<SharedPerson>& child : *children)
+                {
+                    borrowed_ptr<SharedPerson> parent = scope.pin(child->parent);
+                    total += parent->name.size();
+                }
+                *references = scope.size();
+            }
+            keep(total);
+        };
+    };
+    auto printReferences = [children](std::shared_ptr<std::size_t> references)
+    {
+        return [children, references](std::uint64_t)
+        {
+            std::cout << "  references per batch of " << children->size() << ": " << *references << std::endl;
+        };
+    };
+    std::shared_ptr<std::size_t> sortedReferences = std::make_shared<std::size_t>(0);
+    std::shared_ptr<std::size_t> shuffledReferences = std::make_shared<std::size_t>(0);
+    scenarios.push_back({ "pin/copy-each", 10000000, copyScenario, buildChildren(false) });
+    scenarios.push_back({ "pin/scope-sorted", 10000000, pinScenario(sortedReferences), buildChildren(false), printReferences(sortedReferences) });
+    scenarios.push_back({ "pin/copy-each-shuffled", 10000000, copyScenario, buildChildren(true) });
+    scenarios.push_back({ "pin/scope-shuffled", 10000000, pinScenario(shuffledReferences), buildChildren(true), printReferences(shuffledReferences) });
+
+    // False sharing: one thread keeps renaming the Professor while 2 others copy pointers to him.
+    // Ops are pointer copies. With the count in the same cache line as the name, every rename steals the line from the copiers.
+    auto placementScenario = [](PlacedSharedPtr<SharedPerson> (*make)())
+    {
+        return [make](std::uint64_t ops)
+        {
+            PlacedSharedPtr<SharedPerson> professor = make();
+            std::atomic<bool> done{ false };
+            std::thread writer([&professor, &done]()
+            {
+                char letter = 'A';
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    const_cast<volatile char&>(professor->name[0]) = letter++;
+                }
+            });
+
+            std::vector<std::thread> copiers;
+            for (int t = 0; t < 2; t++)
+            {
+                copiers.emplace_back([&professor, ops]()
+                {
+                    for (std::uint64_t i = 0; i < ops / 2; i++)
+                    {
+                        PlacedSharedPtr<SharedPerson> copy = professor;
+                        keep(copy);
+                    }
+                });
+            }
+            for (std::thread& copier : copiers)
+            {
+                copier.join();
+            }
+            done = true;
+            writer.join();
+        };
+    };
+    scenarios.push_back({ "placement/colocated", 10000000, placementScenario([]() { return makePlaced<SharedPerson, ControlBlockPlacement::CoLocated>("Professor"); }) });
+    scenarios.push_back({ "placement/padded", 10000000, placementScenario([]() { return makePlaced<SharedPerson, ControlBlockPlacement::Padded>("Professor"); }) });
+    scenarios.push_back({ "placement/separate", 10000000, placementScenario([]() { return makePlaced<SharedPerson, ControlBlockPlacement::Separate>("Professor"); }) });
+
+    // Handing out 64 character pieces of a 1MB document, by copying them out or by slicing a shared view.
+    // Same for 64 element pieces of a shared array of ints.
+    std::shared_ptr<const std::string> document = std::make_shared<const std::string>(1 << 20, 'x');
+    scenarios.push_back({ "slice/substring-copy", 1000000, [document](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::string piece = document->substr((i * 4099) % (document->size() - 64), 64);
+            keep(piece);
+        }
+    } });
+    scenarios.push_back({ "slice/shared-string-view", 1000000, [document](std::uint64_t ops)
+    {
+        SharedStringView whole(document);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            SharedStringView piece = whole.substr((i * 4099) % (whole.size() - 64), 64);
+            keep(piece);
+        }
+    } });
+
+    const std::size_t arraySize = 1 << 20;
+    std::shared_ptr<int[]> numbers(new int[arraySize]());
+    scenarios.push_back({ "slice/array-copy", 1000000, [numbers, arraySize](std::uint64_t ops)
+    {
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            const int* first = numbers.get() + (i * 4099) % (arraySize - 64);
+            std::vector<int> piece(first, first + 64);
+            keep(piece);
+        }
+    } });
+    scenarios.push_back({ "slice/shared-slice", 1000000, [numbers, arraySize](std::uint64_t ops)
+    {
+        SharedSlice<int> whole(numbers, arraySize);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            SharedSlice<int> piece = whole.slice((i * 4099) % (arraySize - 64), 64);
+            keep(piece);
+        }
+    } });
+
+    // Person::parent plus a generation number and a dirty flag, for every node of one long chain.
+    // "plain" keeps them next to the pointer, "tagged" keeps them in the pointer's spare bits.
+    // Ops are nodes built, walked and torn down (one at a time, a long chain would overflow the stack otherwise).
+    // The unique chains live in an arena so the bytes/node printed afterwards is what they really use
+    // (malloc would round both sizes up to the same 32 byte chunk). --scale 100 for 10^8 nodes if you have the memory.
+    struct PlainNode
+    {
+        std::unique_ptr<PlainNode, ArenaDelete<PlainNode>> parent;
+        std::uint16_t generation = 0;
+        bool dirty = false;
+        std::uint64_t value = 0;
+    };
+    struct TaggedNode
+    {
+        TaggedUniquePtr<TaggedNode, ArenaDelete<TaggedNode>> parent;   // tag() is the generation, flag(0) is dirty.
+        std::uint64_t value = 0;
+    };
+    std::shared_ptr<std::uint64_t> plainReserved = std::make_shared<std::uint64_t>(0);     // By the last run's arena.
+    scenarios.push_back({ "tagged/unique-plain", 1000000, [plainReserved](std::uint64_t ops)
+    {
+        Arena arena;
+        std::unique_ptr<PlainNode, ArenaDelete<PlainNode>> head;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::unique_ptr<PlainNode, ArenaDelete<PlainNode>> child(new (arena.allocate(sizeof(PlainNode), alignof(PlainNode))) PlainNode());
+            child->value = i;
+            child->parent = std::move(head);
+            child->generation = static_cast<std::uint16_t>(i);
+            child->dirty = (i & 1) != 0;
+            head = std::move(child);
+        }
+        std::uint64_t total = 0;
+        for (PlainNode* node = head.get(); node != nullptr; node = node->parent.get())
+        {
+            total += node->dirty ? node->generation : node->value;
+        }
+        keep(total);
+        while (head != nullptr)
+        {
+            head = std::move(head->parent);
+        }
+        *plainReserved = arena.bytesReserved();
+    }, nullptr, [plainReserved](std::uint64_t ops)
+    {
+        std::cout << "  bytes/node: " << sizeof(PlainNode) << " (arena reserved " << *plainReserved / ops << ")" << std::endl;
+    } });
+    std::shared_ptr<std::uint64_t> taggedReserved = std::make_shared<std::uint64_t>(0);
+    scenarios.push_back({ "tagged/unique-tagged", 1000000, [taggedReserved](std::uint64_t ops)
+    {
+        Arena arena;
+        TaggedUniquePtr<TaggedNode, ArenaDelete<TaggedNode>> head;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            TaggedUniquePtr<TaggedNode, ArenaDelete<TaggedNode>> child(new (arena.allocate(sizeof(TaggedNode), alignof(TaggedNode))) TaggedNode(), ArenaDelete<TaggedNode>());
+            child->value = i;
+            child->parent = std::move(head);
+            child->parent.setTag(static_cast<std::uint16_t>(i));    // Set after the move: the tag travels with the pointer.
+            child->parent.setFlag(0, (i & 1) != 0);
+            head = std::move(child);
+        }
+        std::uint64_t total = 0;
+        for (TaggedNode* node = head.get(); node != nullptr; node = node->parent.get())
+        {
+            total += node->parent.flag(0) ? node->parent.tag() : node->value;
+        }
+        keep(total);
+        while (head)
+        {
+            head = std::move(head->parent);
+        }
+        *taggedReserved = arena.bytesReserved();
+    }, nullptr, [taggedReserved](std::uint64_t ops)
+    {
+        std::cout << "  bytes/node: " << sizeof(TaggedNode) << " (arena reserved " << *taggedReserved / ops << ")" << std::endl;
+    } });
+
+    // The same chain with counted parents: shared_ptr (16 bytes, plus a 16 byte control block from make_shared)
+    // against TaggedCountedPtr (8 bytes, plus an 8 byte count in front of the node).
+    struct SharedPlainNode
+    {
+        std::shared_ptr<SharedPlainNode> parent;
+        std::uint16_t generation = 0;
+        bool dirty = false;
+        std::uint64_t value = 0;
+    };
+    struct SharedTaggedNode
+    {
+        TaggedCountedPtr<SharedTaggedNode> parent;
+        std::uint64_t value = 0;
+    };
+    scenarios.push_back({ "tagged/counted-plain", 1000000, [](std::uint64_t ops)
+    {
+        std::shared_ptr<SharedPlainNode> head;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::shared_ptr<SharedPlainNode> child = std::make_shared<SharedPlainNode>();
+            child->value = i;
+            child->parent = std::move(head);
+            child->generation = static_cast<std::uint16_t>(i);
+            child->dirty = (i & 1) != 0;
+            head = std::move(child);
+        }
+        std::uint64_t total = 0;
+        for (SharedPlainNode* node = head.get(); node != nullptr; node = node->parent.get())
+        {
+            total += node->dirty ? node->generation : node->value;
+        }
+        keep(total);
+        while (head != nullptr)
+        {
+            head = std::move(head->parent);
+        }
+    }, nullptr, [](std::uint64_t)
+    {
+        std::cout << "  bytes/node: " << sizeof(SharedPlainNode) << " + 16 control block" << std::endl;
+    } });
+    scenarios.push_back({ "tagged/counted-tagged", 1000000, [](std::uint64_t ops)
+    {
+        TaggedCountedPtr<SharedTaggedNode> head;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            TaggedCountedPtr<SharedTaggedNode> child = makeTaggedCounted<SharedTaggedNode>();
+            child->value = i;
+            child->parent = std::move(head);
+            child->parent.setTag(static_cast<std::uint16_t>(i));
+            child->parent.setFlag(0, (i & 1) != 0);
+            head = std::move(child);
+        }
+        std::uint64_t total = 0;
+        for (SharedTaggedNode* node = head.get(); node != nullptr; node = node->parent.get())
+        {
+            total += node->parent.flag(0) ? node->parent.tag() : node->value;
+        }
+        keep(total);
+        while (head)
+        {
+            head = std::move(head->parent);
+        }
+    }, nullptr, [](std::uint64_t)
+    {
+        std::cout << "  bytes/node: " << sizeof(SharedTaggedNode) << " + 8 count" << std::endl;
+    } });
+
+    // A forest of 1024 unique_ptr chains and a forest of shared_ptr people (each one's parent is someone made earlier),
+    // with normal pointers on the heap ("std") and with 4 byte compressed pointers in a CompressedRegion ("32").
+    // Ops are people built, walked (every chain end to end, every shared person up to its root) and torn down.
+    // Afterwards one more (untimed) run prints how much the resident set grew per person. (Run just these, --scenario compressed/,
+    // so memory freed by earlier scenarios doesn't hide the std growth)
+    const std::size_t compressedChains = 1024;
+    struct StdChainNode
+    {
+        std::unique_ptr<StdChainNode> parent;
+        std::uint32_t id = 0;
+    };
+    struct CompressedChainNode
+    {
+        CompressedUniquePtr<CompressedChainNode> parent;
+        std::uint32_t id = 0;
+    };
+    auto uniqueStd = [=](std::uint64_t ops, bool print)
+    {
+        std::uint64_t before = print ? residentBytes() : 0;
+        std::vector<std::unique_ptr<StdChainNode>> heads(compressedChains);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::unique_ptr<StdChainNode> child(new StdChainNode());
+            child->id = static_cast<std::uint32_t>(i);
+            child->parent = std::move(heads[i % compressedChains]);
+            heads[i % compressedChains] = std::move(child);
+        }
+        std::uint64_t grown = print ? residentGrowth(before) : 0;
+
+        std::uint64_t total = 0;
+        for (const std::unique_ptr<StdChainNode>& head : heads)
+        {
+            for (StdChainNode* node = head.get(); node != nullptr; node = node->parent.get())
+            {
+                total += node->id;
+            }
+        }
+        keep(total);
+        for (std::unique_ptr<StdChainNode>& head : heads)
+        {
+            while (head != nullptr)
+            {
+                head = std::move(head->parent);
+            }
+        }
+        if (print)
+        {
+            std::cout << "  node: " << sizeof(StdChainNode) << " bytes, resident/node: " << grown / ops << " bytes" << std::endl;
+        }
+    };
+    scenarios.push_back({ "compressed/unique-std", 1000000, [uniqueStd](std::uint64_t ops) { uniqueStd(ops, false); }, nullptr,
+        [uniqueStd](std::uint64_t ops) { uniqueStd(ops, true); } });
+    auto unique32 = [=](std::uint64_t ops, bool print)
+    {
+        std::uint64_t before = print ? residentBytes() : 0;
+        CompressedRegion region;
+        CompressedRegion::Scope use(region);
+        std::vector<CompressedUniquePtr<CompressedChainNode>> heads(compressedChains);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            CompressedUniquePtr<CompressedChainNode> child = makeCompressedUnique<CompressedChainNode>();
+            child->id = static_cast<std::uint32_t>(i);
+            child->parent = std::move(heads[i % compressedChains]);
+            heads[i % compressedChains] = std::move(child);
+        }
+        std::uint64_t grown = print ? residentGrowth(before) : 0;
+
+        std::uint64_t total = 0;
+        for (const CompressedUniquePtr<CompressedChainNode>& head : heads)
+        {
+            for (CompressedChainNode* node = head.get(); node != nullptr; node = node->parent.get())
+            {
+                total += node->id;
+            }
+        }
+        keep(total);
+        for (CompressedUniquePtr<CompressedChainNode>& head : heads)
+        {
+            while (head)
+            {
+                head = std::move(head->parent);
+            }
+        }
+        if (print)
+        {
+            std::cout << "  node: " << sizeof(CompressedChainNode) << " bytes, resident/node: " << grown / ops << " bytes" << std::endl;
+        }
+    };
+    scenarios.push_back({ "compressed/unique-32", 1000000, [unique32](std::uint64_t ops) { unique32(ops, false); }, nullptr,
+        [unique32](std::uint64_t ops) { unique32(ops, true); } });
+
+    struct StdForestNode
+    {
+        std::shared_ptr<StdForestNode> parent;
+        std::uint32_t id = 0;
+    };
+    struct CompressedForestNode
+    {
+        CompressedSharedPtr<CompressedForestNode> parent;
+        std::uint32_t id = 0;
+    };
+    auto sharedStd = [](std::uint64_t ops, bool print)
+    {
+        std::uint64_t before = print ? residentBytes() : 0;
+        std::vector<std::shared_ptr<StdForestNode>> people(ops);
+        std::uint64_t random = 88172645463325252ull;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            people[i] = std::make_shared<StdForestNode>();
+            people[i]->id = static_cast<std::uint32_t>(i);
+            random ^= random << 13; random ^= random >> 7; random ^= random << 17;
+            if (i != 0 && random % 64 != 0)     // Every 64th or so is a root.
+            {
+                people[i]->parent = people[random % i];
+            }
+        }
+        std::uint64_t grown = print ? residentGrowth(before) : 0;
+
+        std::uint64_t total = 0;
+        for (const std::shared_ptr<StdForestNode>& person : people)
+        {
+            for (StdForestNode* node = person.get(); node != nullptr; node = node->parent.get())
+            {
+                total += node->id;
+            }
+        }
+        keep(total);
+        people.clear();     // Each person's parent is still in the vector, so nothing here recurses very far.
+        if (print)
+        {
+            std::cout << "  handle: " << sizeof(std::shared_ptr<StdForestNode>) << " bytes, resident/person: " << grown / ops << " bytes" << std::endl;
+        }
+    };
+    scenarios.push_back({ "compressed/shared-std", 1000000, [sharedStd](std::uint64_t ops) { sharedStd(ops, false); }, nullptr,
+        [sharedStd](std::uint64_t ops) { sharedStd(ops, true); } });
+    auto shared32 = [](std::uint64_t ops, bool print)
+    {
+        std::uint64_t before = print ? residentBytes() : 0;
+        CompressedRegion region;
+        CompressedRegion::Scope use(region);
+        std::vector<CompressedSharedPtr<CompressedForestNode>> people(ops);
+        std::uint64_t random = 88172645463325252ull;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            people[i] = makeCompressedShared<CompressedForestNode>();
+            people[i]->id = static_cast<std::uint32_t>(i);
+            random ^= random << 13; random ^= random >> 7; random ^= random << 17;
+            if (i != 0 && random % 64 != 0)
+            {
+                people[i]->parent = people[random % i];
+            }
+        }
+        std::uint64_t grown = print ? residentGrowth(before) : 0;
+
+        std::uint64_t total = 0;
+        for (const CompressedSharedPtr<CompressedForestNode>& person : people)
+        {
+            for (CompressedForestNode* node = person.get(); node != nullptr; node = node->parent.get())
+            {
+                total += node->id;
+            }
+        }
+        keep(total);
+        people.clear();
+        if (print)
+        {
+            std::cout << "  handle: " << sizeof(CompressedSharedPtr<CompressedForestNode>) << " bytes, resident/person: " << grown / ops << " bytes" << std::endl;
+        }
+    };
+    scenarios.push_back({ "compressed/shared-32", 1000000, [shared32](std::uint64_t ops) { shared32(ops, false); }, nullptr,
+        [shared32](std::uint64_t ops) { shared32(ops, true); } });
+
+    // Finding out that people died. Ops are observers registered and then fired (or, for the caches, people who died).
+    // "register" puts a million onExpire callbacks on 1000 people, "queue" does the same with an ExpiryQueue,
+    // "register-contended" has 4 threads piling onto the same 16 people at once.
+    scenarios.push_back({ "expiry/register", 1000000, [](std::uint64_t ops)
+    {
+        std::vector<std::shared_ptr<SharedPerson>> people;
+        for (int i = 0; i < 1000; i++)
+        {
+            people.push_back(makeObservable<SharedPerson>("Fredzilla"));
+        }
+        std::uint64_t fired = 0;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            onExpire(people[i % people.size()], [](void* count) { (*static_cast<std::uint64_t*>(count))++; }, &fired);
+        }
+        people.clear();
+        keep(fired);
+    } });
+    scenarios.push_back({ "expiry/queue", 1000000, [](std::uint64_t ops)
+    {
+        ExpiryQueue<std::uint64_t> dead;
+        std::vector<std::shared_ptr<SharedPerson>> people;
+        for (int i = 0; i < 1000; i++)
+        {
+            people.push_back(makeObservable<SharedPerson>("Fredzilla"));
+        }
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            dead.watch(people[i % people.size()], i);
+        }
+        people.clear();
+        std::uint64_t total = 0;
+        dead.drain([&](std::uint64_t key) { total += key; });
+        keep(total);
+    } });
+    scenarios.push_back({ "expiry/register-contended", 1000000, [](std::uint64_t ops)
+    {
+        std::vector<std::shared_ptr<SharedPerson>> people;
+        for (int i = 0; i < 16; i++)
+        {
+            people.push_back(makeObservable<SharedPerson>("Fredzilla"));
+        }
+        std::atomic<std::uint64_t> fired{ 0 };
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&people, &fired, ops, t]()
+            {
+                for (std::uint64_t i = t; i < ops; i += 4)
+                {
+                    onExpire(people[i % people.size()], [](void* count) { static_cast<std::atomic<std::uint64_t>*>(count)->fetch_add(1, std::memory_order_relaxed); }, &fired);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        people.clear();
+        keep(fired.load());
+    } });
+
+    // A cache of weak_ptrs to everyone, and people dying one at a time. Every 1000 deaths the cache cleans up.
+    // "poll-scan" has to check every entry with expired(), "queue-drain" just erases what the ExpiryQueue hands it.
+    // Only the dying and cleaning is timed, the people and the cache are made in prepare.
+    struct ExpiryCache
+    {
+        std::vector<std::shared_ptr<SharedPerson>> people;
+        std::vector<std::weak_ptr<SharedPerson>> entries;
+        std::unique_ptr<ExpiryQueue<std::size_t>> dead;
+    };
+    const std::size_t cacheSize = 100000;
+    std::shared_ptr<ExpiryCache> cache = std::make_shared<ExpiryCache>();
+    scenarios.push_back({ "expiry/poll-scan", 100000, [cache](std::uint64_t ops)
+    {
+        std::uint64_t dropped = 0;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            cache->people[i].reset();
+            if (i % 1000 == 999)
+            {
+                for (std::weak_ptr<SharedPerson>& entry : cache->entries)
+                {
+                    if (entry.expired())    // (Entries we already dropped look expired too, resetting them again is harmless)
+                    {
+                        entry.reset();
+                        dropped++;
+                    }
+                }
+            }
+        }
+        keep(dropped);
+    }, [cache, cacheSize](std::uint64_t ops)
+    {
+        *cache = ExpiryCache();
+        for (std::size_t i = 0; i < cacheSize + ops; i++)
+        {
+            cache->people.push_back(std::make_shared<SharedPerson>("Fredzilla"));
+            cache->entries.push_back(cache->people.back());
+        }
+    } });
+    scenarios.push_back({ "expiry/queue-drain", 100000, [cache](std::uint64_t ops)
+    {
+        std::uint64_t dropped = 0;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            cache->people[i].reset();
+            if (i % 1000 == 999)
+            {
+                dropped += cache->dead->drain([&](std::size_t key) { cache->entries[key].reset(); });
+            }
+        }
+        keep(dropped);
+    }, [cache, cacheSize](std::uint64_t ops)
+    {
+        *cache = ExpiryCache();
+        cache->dead.reset(new ExpiryQueue<std::size_t>());
+        for (std::size_t i = 0; i < cacheSize + ops; i++)
+        {
+            cache->people.push_back(makeObservable<SharedPerson>("Fredzilla"));
+            cache->entries.push_back(cache->people.back());
+            cache->dead->watch(cache->people.back(), i);
+        }
+    } });
+
+    // Unloading a level: 20000 textures, each one released before the material it depends on.
+    // "unload-immediate" lets go of everything in one frame, "unload-scheduled" hands it to a DestructionScheduler
+    // that gets 1 ms per frame. Ops are textures destroyed; afterwards each prints the longest frame and how many frames its last run took.
+    std::shared_ptr<std::vector<std::shared_ptr<Texture>>> level = std::make_shared<std::vector<std::shared_ptr<Texture>>>();
+    auto loadLevel = [level](std::uint64_t ops)
+    {
+        level->clear();
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            level->push_back(std::make_shared<Texture>());
+            if (i != 0)
+            {
+                (*level)[i - 1]->material = level->back();
+            }
+        }
+    };
+    std::shared_ptr<std::chrono::steady_clock::duration> immediateFrame = std::make_shared<std::chrono::steady_clock::duration>();
+    scenarios.push_back({ "destruction/unload-immediate", 20000, [level, immediateFrame](std::uint64_t)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (std::shared_ptr<Texture>& texture : *level)
+        {
+            texture.reset();
+        }
+        *immediateFrame = std::chrono::steady_clock::now() - start;
+    }, loadLevel, [immediateFrame](std::uint64_t)
+    {
+        std::cout << "  longest frame: " << std::chrono::duration_cast<std::chrono::microseconds>(*immediateFrame).count() << " us, frames: 1" << std::endl;
+    } });
+    std::shared_ptr<std::vector<double>> scheduledFrames = std::make_shared<std::vector<double>>();
+    scenarios.push_back({ "destruction/unload-scheduled", 20000, [level, scheduledFrames](std::uint64_t)
+    {
+        DestructionScheduler scheduler;
+        DestructionScheduler::Ticket previous = 0;
+        for (std::shared_ptr<Texture>& texture : *level)
+        {
+            texture->material.reset();      // The scheduler keeps the order now, so the texture doesn't need to hold its material.
+            previous = scheduler.retire(std::move(texture), { previous });
+        }
+
+        std::vector<double>& frames = *scheduledFrames;
+        frames.clear();
+        while (scheduler.pending() != 0)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            scheduler.tick(0, 1000);
+            frames.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+    }, loadLevel, [scheduledFrames](std::uint64_t)
+    {
+        std::vector<double>& frames = *scheduledFrames;
+        double longest = *std::max_element(frames.begin(), frames.end());
+        std::cout << "  longest frame: " << static_cast<long>(longest) << " us, median frame: " << static_cast<long>(medianOf(frames))
+                  << " us, frames: " << frames.size() << std::endl;
+    } });
+
+    // buttercup's whole family going away at once: 1000 chains of ancestors, a million people by default
+    // (--scale 10 for 10^7 if you have the memory). Ops are people released. The family is built in prepare.
+    // "release/immediate" lets go of it in one go, "release/incremental" pumps an IncrementalReleaser 100 us at a time.
+    // Afterwards each prints the longest single call and the median one from its last run.
+    std::shared_ptr<std::vector<std::shared_ptr<IncrementalPerson>>> family = std::make_shared<std::vector<std::shared_ptr<IncrementalPerson>>>();
+    auto buildFamily = [family](std::uint64_t ops)
+    {
+        family->clear();
+        for (std::size_t chain = 0; chain < 1000; chain++)
+        {
+            std::shared_ptr<IncrementalPerson> person;
+            for (std::uint64_t i = chain; i < ops; i += 1000)
+            {
+                std::shared_ptr<IncrementalPerson> child = std::make_shared<IncrementalPerson>("Buttercup");
+                child->parent = std::move(person);
+                person = std::move(child);
+            }
+            family->push_back(std::move(person));
+        }
+    };
+    std::shared_ptr<long> immediateMicros = std::make_shared<long>(0);
+    scenarios.push_back({ "release/immediate", 1000000, [family, immediateMicros](std::uint64_t)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        family->clear();
+        *immediateMicros = static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }, buildFamily, [immediateMicros](std::uint64_t)
+    {
+        std::cout << "  longest call: " << *immediateMicros << " us" << std::endl;
+    } });
+    std::shared_ptr<std::vector<double>> incrementalCalls = std::make_shared<std::vector<double>>();
+    scenarios.push_back({ "release/incremental", 1000000, [family, incrementalCalls](std::uint64_t)
+    {
+        IncrementalReleaser releaser;
+        releaser.release(std::move(*family));
+
+        std::vector<double>& calls = *incrementalCalls;
+        calls.clear();
+        while (releaser.pending() != 0)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            releaser.pump(0, 100);
+            calls.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+    }, buildFamily, [incrementalCalls](std::uint64_t)
+    {
+        std::vector<double>& calls = *incrementalCalls;
+        std::sort(calls.begin(), calls.end());
+        std::size_t over = calls.end() - std::upper_bound(calls.begin(), calls.end(), 200.0);
+        std::cout << "  longest call: " << static_cast<long>(calls.back()) << " us, median: " << static_cast<long>(medianOf(calls))
+                  << " us, over 2x budget: " << over << " of " << calls.size() << std::endl;
+    } });
+
+    // A request processing loop over 1000 registered users: look one up, authorize it, build and render a response.
+    // "requests/shared" does it with shared_ptr, "requests/deferred" with HeapRef/LocalRef and one DeferredScope per request.
+    // Ops are requests. Afterwards the deferred one prints how many reference count operations were never done.
+    scenarios.push_back({ "requests/shared", 1000000, [](std::uint64_t ops)
+    {
+        std::thread([]() {}).join();    // A real service has threads, so libstdc++ counts atomically. (Until it sees one, it doesn't)
+
+        std::vector<std::shared_ptr<StdUser>> registry;
+        for (int i = 0; i < 1000; i++)
+        {
+            registry.push_back(std::make_shared<StdUser>("user" + std::to_string(i)));
+            registry.back()->manager = registry[i / 10];
+        }
+
+        std::size_t total = 0;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            std::shared_ptr<StdUser> user = registry[i % registry.size()];
+            if (authorize(user))
+            {
+                std::shared_ptr<StdResponse> response = std::make_shared<StdResponse>();
+                response->user = user;
+                response->bytes = i & 255;
+                total += render(response);
+            }
+        }
+        keep(total);
+    } });
+    std::shared_ptr<DeferredHeap::Stats> deferredStats = std::make_shared<DeferredHeap::Stats>();
+    scenarios.push_back({ "requests/deferred", 1000000, [deferredStats](std::uint64_t ops)
+    {
+        DeferredHeap& heap = DeferredHeap::local();
+        std::vector<HeapRef<DeferredUser>> registry;
+        for (int i = 0; i < 1000; i++)
+        {
+            registry.push_back(makeDeferred<DeferredUser>("user" + std::to_string(i)));
+            registry.back()->manager = registry[i / 10];
+        }
+        heap.reconcile();
+        heap.resetStatistics();
+
+        std::size_t total = 0;
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            DeferredScope request;
+            LocalRef<DeferredUser> user = registry[i % registry.size()];
+            if (authorize(user))
+            {
+                LocalRef<DeferredResponse> response = makeDeferred<DeferredResponse>();
+                response->user = user;
+                response->bytes = i & 255;
+                total += render(response);
+            }
+        }
+        keep(total);
+
+        *deferredStats = heap.statistics();
+        registry.clear();
+        heap.reconcile();
+    }, nullptr, [deferredStats](std::uint64_t)
+    {
+        const DeferredHeap::Stats& stats = *deferredStats;
+        std::cout << "  counted: " << stats.counted << ", not counted: " << stats.uncounted << " ("
+                  << 100 * stats.uncounted / (stats.counted + stats.uncounted) << "% eliminated), freed by reconcile: " << stats.freed << std::endl;
+    } });
+
+    // An edge table of a million (child, parent) pairs with a 16 bit tag on each end and a few flags.
+    // "edges/pair" is Pair<unique_ptr, unique_ptr> with the tags and flags next to it, "edges/packed" is a PackedPair.
+    // Ops are edges built and walked (summing the tags). Afterwards each prints its bytes per edge.
+    struct PairEdge
+    {
+        Pair<std::unique_ptr<UniquePerson>, std::unique_ptr<UniquePerson>> people;
+        std::uint16_t childTag;
+        std::uint16_t parentTag;
+        std::uint8_t flags;
+    };
+    scenarios.push_back({ "edges/pair", 1000000, [](std::uint64_t ops)
+    {
+        std::vector<PairEdge> edges;
+        edges.reserve(ops);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            edges.push_back({ Pair<std::unique_ptr<UniquePerson>, std::unique_ptr<UniquePerson>>(
+                std::unique_ptr<UniquePerson>(new UniquePerson("child")), std::unique_ptr<UniquePerson>(new UniquePerson("parent"))),
+                static_cast<std::uint16_t>(i), static_cast<std::uint16_t>(i >> 16), static_cast<std::uint8_t>(i & 3) });
+        }
+        std::uint64_t total = 0;
+        for (const PairEdge& edge : edges)
+        {
+            total += edge.childTag + edge.parentTag + edge.flags + edge.people.first->name.size();
+        }
+        keep(total);
+    }, nullptr, [](std::uint64_t)
+    {
+        std::cout << "  bytes/edge: " << sizeof(PairEdge) << std::endl;
+    } });
+    scenarios.push_back({ "edges/packed", 1000000, [](std::uint64_t ops)
+    {
+        std::vector<PackedPair<UniquePerson, UniquePerson>> edges;
+        edges.reserve(ops);
+        for (std::uint64_t i = 0; i < ops; i++)
+        {
+            edges.emplace_back(std::unique_ptr<UniquePerson>(new UniquePerson("child")), std::unique_ptr<UniquePerson>(new UniquePerson("parent")));
+            edges.back().setFirstTag(static_cast<std::uint16_t>(i));
+            edges.back().setSecondTag(static_cast<std::uint16_t>(i >> 16));
+            edges.back().setFirstFlags(static_cast<unsigned>(i & 3));
+        }
+        std::uint64_t total = 0;
+        for (const PackedPair<UniquePerson, UniquePerson>& edge : edges)
+        {
+            total += edge.firstTag() + edge.secondTag() + edge.firstFlags() + edge.first()->name.size();
+        }
+        keep(total);
+    }, nullptr, [](std::uint64_t)
+    {
+        std::cout << "  bytes/edge: " << sizeof(PackedPair<UniquePerson, UniquePerson>) << std::endl;
+    } });
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+    // 1000 requests in flight on an event loop, each reading the Professor's name in 3 steps with a co_await in each.
+    // Each op is one request. Afterwards each prints how many strong reference count operations a request cost.
+    auto requestScenario = [](bool owned, std::shared_ptr<double> perRequest)
+    {
+        return [owned, perRequest](std::uint64_t ops)
+        {
+            std::shared_ptr<SharedPerson> professor = std::make_shared<SharedPerson>("Professor");
+            std::size_t total = 0;
+            std::uint64_t before = refcountOperations;
+            for (std::uint64_t done = 0; done < ops; done += 1000)
+            {
+                EventLoop loop;
+                for (std::uint64_t i = done; i < ops && i < done + 1000; i++)
+                {
+                    if (owned)
+                    {
+                        loop.spawn(handleRequestOwned(loop, professor, total));
+                    }
+                    else
+                    {
+                        loop.spawn(handleRequestCopied(loop, CountedShared<SharedPerson>(std::shared_ptr<SharedPerson>(professor)), total));
+                    }
+                }
+                loop.run();
+            }
+            keep(total);
+            *perRequest = static_cast<double>(refcountOperations - before) / static_cast<double>(ops);
+        };
+    };
+    auto printRefcountOperations = [](std::shared_ptr<double> perRequest)
+    {
+        return [perRequest](std::uint64_t)
+        {
+            std::cout << "  strong refcount ops/request: " << *perRequest << std::endl;
+        };
+    };
+    std::shared_ptr<double> copiedOperations = std::make_shared<double>(0);
+    std::shared_ptr<double> ownedOperations = std::make_shared<double>(0);
+    scenarios.push_back({ "coroutine/request-copied", 1000000, requestScenario(false, copiedOperations), nullptr, printRefcountOperations(copiedOperations) });
+    scenarios.push_back({ "coroutine/request-owned", 1000000, requestScenario(true, ownedOperations), nullptr, printRefcountOperations(ownedOperations) });
+#endif
+
+    // A million people in a 4-ary family tree, built in parallel with per-thread arenas.
+    // Compare against "forest/serial", which is the same tree built the plain way with make_shared on one thread.
+    const std::size_t forestSize = 1000000;
+    auto forestName = [](std::size_t i) { return "Person " + std::to_string(i); };
+    auto forestParent = [](std::size_t i) { return i == 0 ? SharedForest<SharedPerson>::NoParent : (i - 1) / 4; };
+
+    scenarios.push_back({ "forest/serial", forestSize, [=](std::uint64_t ops)
+    {
+        std::vector<std::shared_ptr<SharedPerson>> people(ops);
+        for (std::size_t i = 0; i < ops; i++)
+        {
+            people[i] = std::make_shared<SharedPerson>(forestName(i));
+            if (i != 0)
+            {
+                people[i]->parent = people[forestParent(i)];
+            }
+        }
+        while (!people.empty())
+        {
+            people.pop_back();
+        }
+    } });
+
+    for (unsigned threads = 1; threads <= 64; threads *= 2)
+    {
+        scenarios.push_back({ "forest/parallel-" + std::to_string(threads) + "t", forestSize, [=](std::uint64_t ops)
+        {
+            WorkStealingPool pool(threads);
+            SharedForest<SharedPerson> forest(pool, ops, forestName, forestParent);
+            keep(forest[ops - 1]);
+        } });
+    }
+
+    // Tearing down a forest of 1024 long chains (a million people by default, --scale 100 for 10^8 if you have the memory).
+    // Only the teardown is timed: the chains are built in prepare.
+    // "teardown/serial" is the normal way, the last handle going away sets off each whole chain of destructors.
+    const std::size_t teardownSize = 1000000;
+    const std::size_t teardownChains = 1024;
+    std::shared_ptr<std::vector<std::shared_ptr<TeardownPerson>>> handles = std::make_shared<std::vector<std::shared_ptr<TeardownPerson>>>();
+    auto buildChains = [handles, teardownChains](std::uint64_t ops)
+    {
+        handles->clear();
+        for (std::size_t chain = 0; chain < teardownChains; chain++)
+        {
+            std::shared_ptr<TeardownPerson> person;
+            for (std::uint64_t i = chain; i < ops; i += teardownChains)
+            {
+                std::shared_ptr<TeardownPerson> child = std::make_shared<TeardownPerson>("Person");
+                child->parent = std::move(person);
+                person = std::move(child);
+            }
+            handles->push_back(std::move(person));
+        }
+    };
+
+    scenarios.push_back({ "teardown/serial", teardownSize, [handles](std::uint64_t)
+    {
+        handles->clear();
+    }, buildChains });
+
+    for (unsigned threads = 1; threads <= 64; threads *= 2)
+    {
+        std::shared_ptr<std::unique_ptr<WorkStealingPool>> pool = std::make_shared<std::unique_ptr<WorkStealingPool>>();
+        scenarios.push_back({ "teardown/parallel-" + std::to_string(threads) + "t", teardownSize, [handles, pool](std::uint64_t)
+        {
+            ParallelTeardown teardown(**pool);
+            teardown.release(std::move(*handles));
+            teardown.wait();
+        }, [buildChains, pool, threads](std::uint64_t ops)
+        {
+            buildChains(ops);
+            if (*pool == nullptr)
+            {
+                pool->reset(new WorkStealingPool(threads));     // Starting the threads isn't part of the teardown either.
+            }
+        } });
+    }
+
+    addPointerMatrix<StdPointers>(scenarios, "std");
+    addPointerMatrix<TunedPointers<>>(scenarios, "tuned");
+    addPointerMatrix<TunedPointers<SeparateBlockPolicy>>(scenarios, "tuned-separate");
+    addPointerMatrix<TunedPointers<PaddedBlockPolicy>>(scenarios, "tuned-padded");
+    addPointerMatrix<TunedPointers<RelaxedRefCountPolicy>>(scenarios, "tuned-relaxed");
+    addPointerMatrix<sp::Selected>(scenarios, "sp");      // Whichever sp:: was compiled in: same names with make STD=1, to --check one against the other.
+
+    addImmortalWorkload<StdPointers, false>(scenarios, "std");
+    addImmortalWorkload<TunedPointers<>, false>(scenarios, "tuned");
+    addImmortalWorkload<TunedPointers<ImmortalRefCountPolicy>, false>(scenarios, "tuned-unmarked");     // Just the cost of the check.
+    addImmortalWorkload<TunedPointers<ImmortalRefCountPolicy>, true>(scenarios, "tuned-immortal");
+
+#ifndef _WIN32
+    addShmScenarios(scenarios);
+    addRemoteScenarios(scenarios);
+#endif
+
+    return scenarios;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    double scale = 1.0;
+    bool list = false;
+    std::ostream* statsOutput = nullptr;
+    ScopeStats::Format statsFormat = ScopeStats::Json;
+    int repeat = 1;
+    std::string savePath;
+    std::string checkPath;
+    double threshold = 0.05;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--scenario") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+        {
+            scale = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+        {
+            statsOutput = &std::cerr;
+            statsFormat = std::strcmp(argv[++i], "csv") == 0 ? ScopeStats::Csv : ScopeStats::Json;
+        }
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+        {
+            savePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--check") == 0 && i + 1 < argc)
+        {
+            checkPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+        {
+            threshold = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--list") == 0)
+        {
+            list = true;
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--list] [--scenario NAME] [--scale FACTOR] [--stats json|csv]"
+                      << " [--repeat N] [--save FILE] [--check FILE] [--threshold FRACTION]" << std::endl;
+            return 2;
+        }
+    }
+
+    // One run has no spread to compare with, and a gate that silently checks nothing would always pass.
+    if ((!savePath.empty() || !checkPath.empty()) && repeat < 2 && !list)
+    {
+        std::cerr << "--save and --check need --repeat 2 or more (try --repeat 11)" << std::endl;
+        return 2;
+    }
+
+    std::map<std::string, BenchSummary> baseline;
+    if (!checkPath.empty())
+    {
+        baseline = loadBaseline(checkPath);
+        if (baseline.empty())
+        {
+            std::cerr << "no baseline in " << checkPath << ", run with --save first" << std::endl;
+            return 2;
+        }
+    }
+
+    PerfCounters counters;
+    std::map<std::string, BenchSummary> results;
+    int regressions = 0;
+    if (statsOutput != nullptr && statsFormat == ScopeStats::Csv)
+    {
+        ScopeStats::writeCsvHeader(*statsOutput);
+    }
+
+    for (Scenario& scenario : makeScenarios())
+    {
+        if (!filter.empty() && scenario.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        if (list)
+        {
+            std::cout << scenario.name << std::endl;
+            continue;
+        }
+
+        std::uint64_t ops = static_cast<std::uint64_t>(static_cast<double>(scenario.ops) * scale);
+        if (ops == 0)
+        {
+            ops = 1;
+        }
+        {
+            ScopeStats stats(scenario.name, statsOutput, statsFormat);
+            if (repeat == 1)
+            {
+                if (scenario.prepare)
+                {
+                    scenario.prepare(ops);
+                }
+                std::cout << counters.measure(scenario.name, ops, [&]() { scenario.run(ops); }) << std::endl;
+            }
+            else
+            {
+                std::vector<double> nanosecondsPerOp;
+                for (int run = 0; run < repeat; run++)
+                {
+                    if (scenario.prepare)
+                    {
+                        scenario.prepare(ops);
+                    }
+                    PerfSample sample = counters.measure(scenario.name, ops, [&]() { scenario.run(ops); });
+                    nanosecondsPerOp.push_back(sample.wallNanoseconds / static_cast<double>(ops));
+                }
+                BenchSummary summary = summarize(nanosecondsPerOp);
+                results[scenario.name] = summary;
+
+                std::cout << std::fixed << std::setprecision(2) << scenario.name << ": median " << summary.median << " ns/op"
+                          << ", MAD " << summary.mad << ", 95% CI [" << summary.low << ", " << summary.high << "]";
+
+                if (!checkPath.empty())
+                {
+                    auto previous = baseline.find(scenario.name);
+                    if (previous == baseline.end())
+                    {
+                        std::cout << ", no baseline";
+                    }
+                    else
+                    {
+                        double change = (summary.median / previous->second.median - 1.0) * 100.0;
+                        std::cout << ", " << std::showpos << change << std::noshowpos << "% vs baseline";
+                        if (isRegression(previous->second, summary, threshold))
+                        {
+                            std::cout << "  REGRESSION";
+                            regressions++;
+                        }
+                    }
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        // After the timing (and the allocation stats) is done, so nothing it does is counted.
+        if (scenario.report)
+        {
+            scenario.report(ops);
+        }
+    }
+
+    if (!savePath.empty() && !results.empty())
+    {
+        // Keep baselines for scenarios we didn't run this time (e.g. with --scenario).
+        std::map<std::string, BenchSummary> merged = loadBaseline(savePath);
+        for (const auto& result : results)
+        {
+            merged[result.first] = result.second;
+        }
+        if (!saveBaseline(savePath, merged))
+        {
+            std::cerr << "couldn't write baseline " << savePath << std::endl;
+            return 2;
+        }
+    }
+
+    if (regressions > 0)
+    {
+        std::cout << regressions << " scenario(s) regressed by more than " << threshold * 100.0 << "%" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+Incremental Release Budget Check
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Another separate program. It checks the promise header/incremental_release.h makes about pump(0, budget):
+// it stops as soon as the budget is used up, so it can only go over by the one destructor that was running at the time.
+//
+// A family of chains is released through an IncrementalReleaser, one pump at a time. The people carry payloads of
+// random sizes, so some destructors are cheap and some take a while (hundreds of microseconds for the big ones).
+// "Only one destructor too many" means: once a release has finished after the budget ran out, no other one starts.
+// The people come from an allocator that notes when each release finished (giving back the memory is the last thing
+// a release does), and each destructor checks that the release before it in the same pump finished in time.
+// The budget is counted from when the first destructor of a pump starts, which can't be before the pump itself
+// started, plus `slack` for the clock.
+//
+// Checking that instead of how long pumps take keeps the check honest on a busy or virtual machine:
+// if the OS (or the hypervisor) stops us for a while in the middle of a release, the pump is late, but the releaser
+// did nothing wrong. The pump times are printed too, for a look at what they really were.
+// Exits with 1 if any release started when the budget was already used up.
+//
+//     check_release_budget                        100 us budget, 200000 people (make release-budget)
+//     check_release_budget --budget 50 --people 1000000 --slack 2 --seed 7
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../header/incremental_release.h"
+
+
+typedef std::chrono::steady_clock Clock;
+
+Clock::duration budgetWithSlack;
+Clock::time_point deadline;                                 // When the running pump's budget is gone (plus slack).
+Clock::time_point lastReleaseDone;
+bool firstInPump = false;
+std::size_t lateStarts = 0;
+double latestStart = 0;                                     // How far past the deadline the release before a late one finished, in us.
+
+// std::allocator, but it notes when memory was given back: the end of a release.
+template<class T>
+struct MarkingAllocator
+{
+    typedef T value_type;
+
+    MarkingAllocator() = default;
+    template<class U>
+    MarkingAllocator(const MarkingAllocator<U>&) {}
+
+    T* allocate(std::size_t count) { return std::allocator<T>().allocate(count); }
+
+    void deallocate(T* memory, std::size_t count)
+    {
+        std::allocator<T>().deallocate(memory, count);
+        lastReleaseDone = Clock::now();
+    }
+
+    template<class U>
+    bool operator==(const MarkingAllocator<U>&) const { return true; }
+};
+
+struct Person
+{
+    std::vector<char> payload;
+    std::shared_ptr<Person> parent;
+
+    explicit Person(std::size_t bytes) : payload(bytes, 'x') {}
+
+    ~Person()
+    {
+        if (firstInPump)                                    // The first one always runs, whatever the budget.
+        {
+            deadline = Clock::now() + budgetWithSlack;
+        }
+        else if (lastReleaseDone > deadline)
+        {
+            lateStarts++;
+            latestStart = std::max(latestStart, std::chrono::duration<double, std::micro>(lastReleaseDone - deadline).count());
+        }
+        firstInPump = false;
+        IncrementalReleaser::defer(std::move(parent));
+    }
+};
+
+int main(int argc, char** argv)
+{
+    std::uint64_t budget = 100;
+    std::size_t people = 200000;
+    double slack = 5;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            budget = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--people") == 0 && i + 1 < argc)
+        {
+            people = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--slack") == 0 && i + 1 < argc)
+        {
+            slack = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--budget MICROS] [--people N] [--slack MICROS] [--seed N]" << std::endl;
+            return 2;
+        }
+    }
+
+    // 100 chains. Most payloads are small, one in 64 is big enough that its destructor alone is a good part of the budget.
+    std::mt19937 random(seed);
+    std::vector<std::shared_ptr<Person>> family(100);
+    for (std::size_t i = 0; i < people; i++)
+    {
+        std::size_t bytes = random() % 64 == 0 ? 256 * 1024 + random() % (1024 * 1024) : random() % 256;
+        std::shared_ptr<Person> child = std::allocate_shared<Person>(MarkingAllocator<Person>(), bytes);
+        child->parent = std::move(family[i % family.size()]);
+        family[i % family.size()] = std::move(child);
+    }
+
+    budgetWithSlack = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(static_cast<double>(budget) + slack));
+    IncrementalReleaser releaser;
+    releaser.release(std::move(family));
+
+    std::vector<double> pumps;
+    while (releaser.pending() != 0)
+    {
+        Clock::time_point start = Clock::now();
+        firstInPump = true;
+        releaser.pump(0, budget);
+        pumps.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    std::sort(pumps.begin(), pumps.end());
+    std::cout << "pumps: " << pumps.size() << ", median: " << pumps[pumps.size() / 2] << " us, longest: " << pumps.back()
+              << " us, releases started after the budget was used up: " << lateStarts;
+    if (lateStarts != 0)
+    {
+        std::cout << " (the one before finished up to " << latestStart << " us past it)";
+    }
+    std::cout << std::endl;
+    return lateStarts == 0 ? 0 : 1;
+}
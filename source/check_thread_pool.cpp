@@ -0,0 +1,127 @@
+/*
+Thread Pool Check
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Another separate program. It checks that WorkStealingPool::parallelFor works from inside a task:
+// a parallelFor whose body runs a parallelFor, and tasks that each run one, on pools of 1 to 8 threads.
+// With one thread that thread is waiting inside a task and has to do all the work itself meanwhile.
+//
+// A deadlock is what this looks for, so a watchdog ends the program with 1 if it takes too long.
+// Exits with 1 if a deadlock or a wrong sum turns up.
+//
+//     check_thread_pool                   (make thread-pool)
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "../header/thread_pool.h"
+
+
+const std::size_t Outer = 64;
+const std::size_t Inner = 1000;
+
+// The sum of i * j for every i below Outer and j below Inner, the answer both checks should come to.
+std::uint64_t expectedSum()
+{
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < Outer; i++)
+    {
+        for (std::size_t j = 0; j < Inner; j++)
+        {
+            sum += i * j;
+        }
+    }
+    return sum;
+}
+
+// A parallelFor inside a parallelFor.
+std::uint64_t nestedLoops(WorkStealingPool& pool)
+{
+    std::atomic<std::uint64_t> sum{ 0 };
+    pool.parallelFor(0, Outer, 1, [&](std::size_t i)
+    {
+        pool.parallelFor(0, Inner, 16, [&](std::size_t j)
+        {
+            sum.fetch_add(i * j, std::memory_order_relaxed);
+        });
+    });
+    return sum.load();
+}
+
+// Plain tasks that each run a parallelFor, then a wait() from outside for all of them.
+std::uint64_t loopsInTasks(WorkStealingPool& pool)
+{
+    std::atomic<std::uint64_t> sum{ 0 };
+    for (std::size_t i = 0; i < Outer; i++)
+    {
+        pool.submit([&pool, &sum, i]()
+        {
+            pool.parallelFor(0, Inner, 16, [&sum, i](std::size_t j)
+            {
+                sum.fetch_add(i * j, std::memory_order_relaxed);
+            });
+        });
+    }
+    pool.wait();
+    return sum.load();
+}
+
+int main()
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    std::thread watchdog([&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!condition.wait_for(lock, std::chrono::seconds(60), [&]() { return done; }))
+        {
+            std::cout << "still running after 60 seconds, the pool is deadlocked" << std::endl;
+            std::_Exit(1);
+        }
+    });
+
+    std::uint64_t expected = expectedSum();
+    int failures = 0;
+    for (unsigned threads : { 1u, 2u, 4u, 8u })
+    {
+        WorkStealingPool pool(threads);
+        for (int round = 0; round < 20; round++)
+        {
+            std::uint64_t nested = nestedLoops(pool);
+            std::uint64_t inTasks = loopsInTasks(pool);
+            if (nested != expected || inTasks != expected)
+            {
+                std::cout << threads << " threads: got " << nested << " and " << inTasks << ", expected " << expected << std::endl;
+                failures++;
+            }
+        }
+        std::cout << threads << " threads: " << (failures == 0 ? "ok" : "FAILED") << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    condition.notify_one();
+    watchdog.join();
+    return failures == 0 ? 0 : 1;
+}
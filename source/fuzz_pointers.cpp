@@ -0,0 +1,394 @@
+/*
+Smart Pointer Fuzzer
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Another separate program. It checks the pointers from header/tuned_ptr.h against the std ones:
+// the same random sequence of operations (make, copy, move, swap, reset, release, lock...) is done to a set of std
+// pointers and to a set of tuned ones, and after every step everything we can see has to match:
+// who points at what, every use_count, every expired(), which objects have been destroyed, and in what order.
+//
+//     fuzz_pointers                      1000 random sequences of 200 steps, for each policy
+//     fuzz_pointers --iterations 50000   more sequences
+//     fuzz_pointers --seed 1234          a different (or the failing) starting seed
+//     fuzz_pointers --threads            instead: hammer copies, locks and releases from several threads at once
+//
+// `make fuzz` builds it with AddressSanitizer and UndefinedBehaviorSanitizer, `make fuzz-tsan` runs --threads under
+// ThreadSanitizer. A mismatch prints the seed and step, so it can be run again.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../header/pointer_switch.h"
+
+
+// Objects that remember being destroyed. Each world gets its own Tag so the two logs don't mix.
+template<int Tag>
+struct Tracked
+{
+    int id;
+
+    explicit Tracked(int id) : id(id)
+    {
+        alive()++;
+    }
+
+    ~Tracked()
+    {
+        alive()--;
+        destroyed().push_back(id);
+    }
+
+    static int& alive()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    static std::vector<int>& destroyed()
+    {
+        static std::vector<int> log;
+        return log;
+    }
+};
+
+
+struct Step
+{
+    int op;
+    int a;
+    int b;
+    int id;
+};
+
+const int Slots = 4;        // Few slots, so operations keep running into each other.
+const int Operations = 22;
+
+
+// A set of unique, shared and weak pointers of one kind (std or tuned), and the operations on them.
+template<class Pointers, int Tag>
+class World
+{
+public:
+    typedef Tracked<Tag> T;
+    typedef typename Pointers::template Unique<T> Unique;
+    typedef typename Pointers::template Shared<T> Shared;
+    typedef typename Pointers::template Weak<T> Weak;
+
+    void apply(const Step& step)
+    {
+        int a = step.a;
+        int b = step.b;
+        switch (step.op)
+        {
+        case 0: uniques[a] = Unique(new T(step.id)); break;
+        case 1: uniques[a] = Pointers::template makeUnique<T>(step.id); break;
+        case 2: uniques[a].reset(); break;
+        case 3: uniques[a] = std::move(uniques[b]); break;
+        case 4: uniques[a].swap(uniques[b]); break;
+        case 5: delete uniques[a].release(); break;
+        case 6: shareds[a] = Shared(std::move(uniques[b])); break;
+        case 7: shareds[a] = Shared(new T(step.id)); break;
+        case 8: shareds[a] = Pointers::template makeShared<T>(step.id); break;
+        case 9: shareds[a] = shareds[b]; break;
+        case 10: shareds[a] = std::move(shareds[b]); break;
+        case 11: shareds[a].reset(); break;
+        case 12: shareds[a].swap(shareds[b]); break;
+        case 13: shareds[a] = Shared(shareds[b], shareds[b].get()); break;
+        case 14: shareds[a].reset(new T(step.id)); break;
+        case 15: weaks[a] = shareds[b]; break;
+        case 16: weaks[a] = weaks[b]; break;
+        case 17: weaks[a] = std::move(weaks[b]); break;
+        case 18: weaks[a].reset(); break;
+        case 19: weaks[a].swap(weaks[b]); break;
+        case 20: shareds[a] = weaks[b].lock(); break;
+        case 21:
+            try
+            {
+                shareds[a] = Shared(weaks[b]);
+            }
+            catch (const std::bad_weak_ptr&)
+            {
+                threw++;
+            }
+            break;
+        }
+    }
+
+    // Everything the outside can see, as a list of numbers.
+    std::vector<long> observe()
+    {
+        std::vector<long> seen;
+        for (int i = 0; i < Slots; i++)
+        {
+            seen.push_back(uniques[i] ? uniques[i]->id : -1);
+            seen.push_back(shareds[i] ? shareds[i]->id : -1);
+            seen.push_back(shareds[i].use_count());
+            seen.push_back(weaks[i].use_count());
+            seen.push_back(weaks[i].expired());
+        }
+        seen.push_back(T::alive());
+        seen.push_back(threw);
+        seen.insert(seen.end(), T::destroyed().begin(), T::destroyed().end());
+        T::destroyed().clear();
+        return seen;
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < Slots; i++)
+        {
+            uniques[i].reset();
+            shareds[i].reset();
+            weaks[i].reset();
+        }
+        T::destroyed().clear();
+    }
+
+private:
+    Unique uniques[Slots];
+    Shared shareds[Slots];
+    Weak weaks[Slots];
+    long threw = 0;
+};
+
+
+struct Random
+{
+    std::uint64_t state;
+
+    explicit Random(std::uint64_t seed) : state(seed == 0 ? 88172645463325252ull : seed) {}
+
+    std::uint64_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    int below(int n) { return static_cast<int>(next() % static_cast<std::uint64_t>(n)); }
+};
+
+
+std::string describe(const std::vector<long>& seen)
+{
+    std::string text;
+    for (long value : seen)
+    {
+        text += std::to_string(value) + " ";
+    }
+    return text;
+}
+
+
+// Runs `iterations` random sequences against std. Returns false (after printing what went wrong) on the first mismatch.
+template<class Policy>
+bool differential(const char* name, std::uint64_t seed, int iterations, int steps)
+{
+    World<StdPointers, 0> expected;
+    World<TunedPointers<Policy>, 1> actual;
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        Random random(seed + static_cast<std::uint64_t>(iteration));
+        for (int s = 0; s < steps; s++)
+        {
+            Step step{ random.below(Operations), random.below(Slots), random.below(Slots), s };
+            if ((step.op == 3 || step.op == 10 || step.op == 17) && step.a == step.b)
+            {
+                step.b = (step.a + 1) % Slots;     // Moving into yourself leaves std pointers "valid but unspecified", nothing to compare.
+            }
+            expected.apply(step);
+            actual.apply(step);
+
+            std::vector<long> want = expected.observe();
+            std::vector<long> got = actual.observe();
+            if (want != got)
+            {
+                std::cout << name << ": MISMATCH with seed " << seed + iteration << " at step " << s << " (operation " << step.op
+                          << " on " << step.a << ", " << step.b << ")" << std::endl;
+                std::cout << "  std:   " << describe(want) << std::endl;
+                std::cout << "  tuned: " << describe(got) << std::endl;
+                return false;
+            }
+        }
+        expected.clear();
+        actual.clear();
+        if (Tracked<1>::alive() != 0)
+        {
+            std::cout << name << ": LEAK after seed " << seed + iteration << std::endl;
+            return false;
+        }
+    }
+    std::cout << name << ": " << iterations << " sequences matched" << std::endl;
+    return true;
+}
+
+
+// What the threads share. Each thread writes only its own `touched` entry, with plain (non-atomic) writes,
+// and the deleter reads them all: under TSan, that's a data race unless the counting orders the release properly.
+struct Scratch
+{
+    int round;
+    int touched[4];
+};
+
+// Several threads copying, locking and dropping references to the same objects, racing the final release.
+// Each object has to be destroyed exactly once, and nothing may be left at the end. (Run it under TSan)
+template<class Policy>
+bool threaded(const char* name, std::uint64_t seed, int rounds)
+{
+    typedef TunedSharedPtr<Scratch, Policy> Shared;
+    typedef TunedWeakPtr<Scratch, Policy> Weak;
+
+    static std::atomic<int> destroyed;
+    static std::atomic<int> touches;
+    for (int round = 0; round < rounds; round++)
+    {
+        destroyed = 0;
+        Shared master(new Scratch{ round, {} }, [](Scratch* scratch)
+        {
+            destroyed++;
+            touches = scratch->touched[0] + scratch->touched[1] + scratch->touched[2] + scratch->touched[3];
+            delete scratch;
+        });
+        Weak weakMaster = master;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([copy = master, weakMaster, seed, round, t]() mutable
+            {
+                Random random(seed + round * 4 + t + 1);
+                Shared mine[Slots];
+                Weak weak[Slots];
+                mine[0] = copy;
+                copy.reset();
+                for (int i = 0; i < 2000; i++)
+                {
+                    int a = random.below(Slots);
+                    int b = random.below(Slots);
+                    switch (random.below(6))
+                    {
+                    case 0: mine[a] = mine[b]; break;
+                    case 1: mine[a].reset(); break;
+                    case 2: weak[a] = mine[b]; break;
+                    case 3: mine[a] = weak[b].lock(); break;
+                    case 4: mine[a] = weakMaster.lock(); break;
+                    case 5: weak[a] = weakMaster; break;
+                    }
+                    if (mine[a] != nullptr)
+                    {
+                        if (mine[a]->round != round)
+                        {
+                            std::abort();   // Read a value that wasn't ours: something was freed too early.
+                        }
+                        mine[a]->touched[t]++;
+                    }
+                }
+            });
+        }
+        master.reset();     // Now the last reference is somewhere in the threads.
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        if (!weakMaster.expired() || destroyed != 1 || touches == 0)
+        {
+            std::cout << name << ": round " << round << " destroyed the object " << destroyed << " times" << std::endl;
+            return false;
+        }
+    }
+    std::cout << name << ": " << rounds << " threaded rounds, every object destroyed exactly once" << std::endl;
+    return true;
+}
+
+
+// A couple of other policies, so their code paths get fuzzed too.
+struct SeparateBlockPolicy : DefaultRefCountPolicy
+{
+    static constexpr ControlBlockPlacement placement = ControlBlockPlacement::Separate;
+};
+
+struct PaddedSmallCountPolicy : DefaultRefCountPolicy
+{
+    typedef int Count;
+    static constexpr ControlBlockPlacement placement = ControlBlockPlacement::Padded;
+};
+
+struct RelaxedSeparatePolicy : RelaxedRefCountPolicy
+{
+    static constexpr ControlBlockPlacement placement = ControlBlockPlacement::Separate;
+};
+
+
+int main(int argc, char** argv)
+{
+    std::uint64_t seed = 1;
+    int iterations = 1000;
+    int steps = 200;
+    bool threads = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+        {
+            steps = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            threads = true;
+        }
+        else
+        {
+            std::cerr << "unknown option: " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    bool ok = true;
+    if (threads)
+    {
+        ok = threaded<DefaultRefCountPolicy>("default", seed, iterations / 10 + 1) && ok;
+        ok = threaded<SeparateBlockPolicy>("separate", seed, iterations / 10 + 1) && ok;
+        ok = threaded<PaddedSmallCountPolicy>("padded-int", seed, iterations / 10 + 1) && ok;
+        ok = threaded<RelaxedRefCountPolicy>("relaxed", seed, iterations / 10 + 1) && ok;
+        ok = threaded<RelaxedSeparatePolicy>("relaxed-separate", seed, iterations / 10 + 1) && ok;
+    }
+    else
+    {
+        ok = differential<DefaultRefCountPolicy>("default", seed, iterations, steps) && ok;
+        ok = differential<SeparateBlockPolicy>("separate", seed, iterations, steps) && ok;
+        ok = differential<PaddedSmallCountPolicy>("padded-int", seed, iterations, steps) && ok;
+        ok = differential<RelaxedRefCountPolicy>("relaxed", seed, iterations, steps) && ok;
+        ok = differential<ImmortalRefCountPolicy>("immortal-capable", seed, iterations, steps) && ok;
+    }
+    return ok ? 0 : 1;
+}
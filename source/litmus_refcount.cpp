@@ -0,0 +1,424 @@
+/*
+Reference Count Litmus Tests
+(c) 2026 SmartPointers contributors
+Extends David Erbelding's Smart Pointers tutorial (see source/main.cpp).
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Is RelaxedRefCountPolicy (header/tuned_ptr.h) really enough? Running it on an x86 machine proves nothing:
+// x86 does every lock-prefixed instruction as a full barrier, whatever memory order we ask for.
+// So this program doesn't run the pointers at all. It plays out small programs ("litmus tests") on a model of the
+// C++ memory model, the way a checker like Relacy does, and tries EVERY order the threads' steps could happen in.
+//
+// The model only knows what the standard promises, nothing more, so it's as weak as the weakest machine (ARM, POWER):
+//   - every thread has a vector clock, and one thing "happens before" another only if the clocks say so,
+//   - a release decrement publishes the thread's clock on the counter, an acquire (or a later acquire fence) picks it up,
+//   - relaxed operations only pass along what's already there.
+// The destructor (and freeing the control block) must happen after every other thread's last use of the object.
+// If there's any order of steps where it doesn't, that's a data race: on a weak machine the destructor could see stale memory.
+//
+// The policies are checked with the same orders tuned_ptr.h would use (Policy::incrementOrder and friends), along with
+// two that are broken on purpose, to show the checker does catch it.
+//
+//     litmus_refcount            runs every test for every policy (make litmus)
+//     litmus_refcount --trace    also prints the steps of each race found
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../header/tuned_ptr.h"
+
+
+const int MaxThreads = 3;
+
+// One counter per thread: how far along that thread we've seen.
+struct Clock
+{
+    unsigned at[MaxThreads] = {};
+
+    void join(const Clock& other)
+    {
+        for (int i = 0; i < MaxThreads; i++)
+        {
+            at[i] = at[i] > other.at[i] ? at[i] : other.at[i];
+        }
+    }
+};
+
+
+// Things a thread in a litmus test can do with its references.
+enum class Op
+{
+    Touch,      // Write to the object (each thread to its own part, so the only possible races are the counting's fault).
+    Copy,       // Copy a shared pointer we have.
+    Drop,       // Let go of a shared pointer. If it was the last one: destructor, then let go of the weak count.
+    MakeWeak,   // Make a weak pointer from a shared one we have.
+    DropWeak,   // Let go of a weak pointer (or the strong references' share of it). If it was the last: free the block.
+    Lock,       // weak_ptr::lock(). If it works: touch the object and drop that reference again.
+};
+
+const char* opName(Op op)
+{
+    switch (op)
+    {
+    case Op::Touch: return "touch";
+    case Op::Copy: return "copy";
+    case Op::Drop: return "drop";
+    case Op::MakeWeak: return "make weak";
+    case Op::DropWeak: return "drop weak";
+    case Op::Lock: return "lock";
+    }
+    return "?";
+}
+
+
+struct Orders
+{
+    const char* name;
+    std::memory_order increment;
+    std::memory_order decrement;
+    bool fenceOnZero;
+    bool expectSafe;
+};
+
+template<class Policy>
+Orders ordersOf(const char* name, bool expectSafe)
+{
+    return Orders{ name, Policy::incrementOrder, Policy::decrementOrder, Policy::fenceOnZero, expectSafe };
+}
+
+bool acquires(std::memory_order order)
+{
+    return order == std::memory_order_acquire || order == std::memory_order_acq_rel || order == std::memory_order_seq_cst;
+}
+
+bool releases(std::memory_order order)
+{
+    return order == std::memory_order_release || order == std::memory_order_acq_rel || order == std::memory_order_seq_cst;
+}
+
+
+struct Litmus
+{
+    const char* name;
+    long strong;                        // References handed out before the threads start.
+    long weak;                          // (Including the 1 that belongs to all the strong ones)
+    std::vector<std::vector<Op>> threads;
+};
+
+
+// Everything about one point in one execution. Copied at every branch, it's small.
+struct State
+{
+    struct Counter
+    {
+        long value = 0;
+        Clock released;                 // What a thread that acquires this counter gets to see.
+        Clock lastUse;                  // When each thread last touched the counter (the block must be freed after).
+    };
+
+    struct Thread
+    {
+        std::deque<Op> ops;
+        Clock clock;
+        Clock unfenced;                 // Picked up by relaxed reads, only visible after an acquire fence.
+    };
+
+    Thread threads[MaxThreads];
+    int threadCount = 0;
+    Counter strong;
+    Counter weak;
+    Clock objectUse;                    // When each thread last touched the object.
+    bool destroyed = false;
+    bool freed = false;
+    std::vector<std::pair<int, Op>> steps;
+};
+
+
+class Checker
+{
+public:
+    Checker(const Orders& orders, bool trace) : orders(orders), trace(trace) {}
+
+    // Tries every interleaving. Returns the problem found, or "" if there was none.
+    std::string run(const Litmus& litmus)
+    {
+        State start;
+        start.threadCount = static_cast<int>(litmus.threads.size());
+        start.strong.value = litmus.strong;
+        start.weak.value = litmus.weak;
+        for (int t = 0; t < start.threadCount; t++)
+        {
+            start.threads[t].ops.assign(litmus.threads[t].begin(), litmus.threads[t].end());
+        }
+        problem.clear();
+        explore(start);
+        return problem;
+    }
+
+    std::uint64_t executions = 0;
+    std::uint64_t decrements = 0;
+    std::uint64_t acquiringDecrements = 0;     // Decrements that had to wait for other threads' memory (the barriers ARM pays for).
+
+private:
+    Orders orders;
+    bool trace;
+    std::string problem;
+
+    void explore(const State& state)
+    {
+        bool anyLeft = false;
+        for (int t = 0; t < state.threadCount && problem.empty(); t++)
+        {
+            if (state.threads[t].ops.empty())
+            {
+                continue;
+            }
+            anyLeft = true;
+            State next = state;
+            std::string error = step(next, t);
+            if (!error.empty())
+            {
+                problem = error;
+                if (trace)
+                {
+                    problem += "\n      after:";
+                    for (const std::pair<int, Op>& done : next.steps)
+                    {
+                        problem += " T" + std::to_string(done.first) + "." + opName(done.second);
+                    }
+                }
+                return;
+            }
+            explore(next);
+        }
+        if (!anyLeft)
+        {
+            executions++;
+        }
+    }
+
+    // A read-modify-write on a counter, in the given memory order. Returns the value from before.
+    long modify(State& state, int t, State::Counter& counter, std::memory_order order, long delta)
+    {
+        State::Thread& thread = state.threads[t];
+        if (acquires(order))
+        {
+            thread.clock.join(counter.released);
+        }
+        else
+        {
+            thread.unfenced.join(counter.released);
+        }
+        counter.lastUse.at[t] = thread.clock.at[t];
+        if (releases(order))
+        {
+            counter.released.join(thread.clock);    // Read-modify-writes keep earlier releases going, so this adds to them.
+        }
+        long before = counter.value;
+        counter.value += delta;
+        return before;
+    }
+
+    // Does `thread` see every other thread's last use in `uses`?
+    static int racingThread(const State& state, int t, const Clock& uses)
+    {
+        for (int other = 0; other < state.threadCount; other++)
+        {
+            if (other != t && uses.at[other] > state.threads[t].clock.at[other])
+            {
+                return other;
+            }
+        }
+        return -1;
+    }
+
+    void acquireAfterZero(State& state, int t)
+    {
+        if (orders.fenceOnZero)
+        {
+            state.threads[t].clock.join(state.threads[t].unfenced);
+        }
+        if (acquires(orders.decrement) || orders.fenceOnZero)
+        {
+            acquiringDecrements++;
+        }
+    }
+
+    std::string step(State& state, int t)
+    {
+        State::Thread& thread = state.threads[t];
+        Op op = thread.ops.front();
+        thread.ops.pop_front();
+        thread.clock.at[t]++;
+        state.steps.push_back({ t, op });
+
+        std::string who = "T" + std::to_string(t) + " ";
+        if (state.freed)
+        {
+            return who + opName(op) + " after the control block was freed";
+        }
+
+        switch (op)
+        {
+        case Op::Touch:
+            if (state.destroyed)
+            {
+                return who + "touched the object after its destructor";
+            }
+            state.objectUse.at[t] = thread.clock.at[t];
+            break;
+
+        case Op::Copy:
+            if (modify(state, t, state.strong, orders.increment, 1) == 0)
+            {
+                return who + "copied a pointer to a destroyed object";
+            }
+            break;
+
+        case Op::MakeWeak:
+            modify(state, t, state.weak, orders.increment, 1);
+            break;
+
+        case Op::Drop:
+            decrements++;
+            if (acquires(orders.decrement))
+            {
+                acquiringDecrements++;
+            }
+            if (modify(state, t, state.strong, orders.decrement, -1) == 1)
+            {
+                if (!acquires(orders.decrement))
+                {
+                    acquireAfterZero(state, t);
+                }
+                int other = racingThread(state, t, state.objectUse);
+                if (other >= 0)
+                {
+                    return who + "ran the destructor without seeing T" + std::to_string(other) + "'s last touch";
+                }
+                state.destroyed = true;
+                thread.ops.push_front(Op::DropWeak);
+            }
+            break;
+
+        case Op::DropWeak:
+            decrements++;
+            if (acquires(orders.decrement))
+            {
+                acquiringDecrements++;
+            }
+            if (modify(state, t, state.weak, orders.decrement, -1) == 1)
+            {
+                if (!acquires(orders.decrement))
+                {
+                    acquireAfterZero(state, t);
+                }
+                int other = racingThread(state, t, state.objectUse);
+                if (other < 0)
+                {
+                    other = racingThread(state, t, state.strong.lastUse);
+                }
+                if (other < 0)
+                {
+                    other = racingThread(state, t, state.weak.lastUse);
+                }
+                if (other >= 0)
+                {
+                    return who + "freed the block without seeing T" + std::to_string(other) + "'s last use of it";
+                }
+                state.freed = true;
+            }
+            break;
+
+        case Op::Lock:
+            // tryAddStrong(): a relaxed load, then a compare-exchange (acq_rel) if it wasn't 0.
+            // The loop in there only retries when someone else changed the count, so one step covers it.
+            if (state.strong.value == 0)
+            {
+                thread.unfenced.join(state.strong.released);
+                state.strong.lastUse.at[t] = thread.clock.at[t];
+            }
+            else
+            {
+                modify(state, t, state.strong, std::memory_order_acq_rel, 1);
+                thread.ops.push_front(Op::Drop);
+                thread.ops.push_front(Op::Touch);
+            }
+            break;
+        }
+        return "";
+    }
+};
+
+
+// A couple of policies that are broken on purpose. The checker has to find something wrong with them.
+struct ReleaseWithoutFencePolicy : DefaultRefCountPolicy
+{
+    static constexpr std::memory_order decrementOrder = std::memory_order_release;
+};
+
+struct RelaxedDecrementPolicy : DefaultRefCountPolicy
+{
+    static constexpr std::memory_order decrementOrder = std::memory_order_relaxed;
+    static constexpr bool fenceOnZero = true;
+};
+
+
+int main(int argc, char** argv)
+{
+    bool trace = argc > 1 && std::strcmp(argv[1], "--trace") == 0;
+
+    std::vector<Litmus> tests = {
+        { "two owners", 2, 1, { { Op::Touch, Op::Drop }, { Op::Touch, Op::Drop } } },
+        { "three owners", 3, 1, { { Op::Touch, Op::Drop }, { Op::Touch, Op::Drop }, { Op::Touch, Op::Drop } } },
+        { "copy then drop both", 2, 1, { { Op::Touch, Op::Copy, Op::Touch, Op::Drop, Op::Drop }, { Op::Touch, Op::Drop } } },
+        { "weak pointer locks", 2, 2, { { Op::Touch, Op::Drop }, { Op::Touch, Op::Drop }, { Op::Lock, Op::DropWeak } } },
+        { "weak pointer outlives", 2, 1, { { Op::Touch, Op::MakeWeak, Op::Drop, Op::DropWeak }, { Op::Touch, Op::Drop } } },
+        { "two weak pointers", 1, 3, { { Op::Touch, Op::Drop }, { Op::Lock, Op::DropWeak }, { Op::Lock, Op::DropWeak } } },
+    };
+
+    std::vector<Orders> policies = {
+        ordersOf<DefaultRefCountPolicy>("default (acq_rel)", true),
+        ordersOf<RelaxedRefCountPolicy>("relaxed (release + fence)", true),
+        ordersOf<ReleaseWithoutFencePolicy>("broken: release, no fence", false),
+        ordersOf<RelaxedDecrementPolicy>("broken: relaxed decrements", false),
+    };
+
+    bool ok = true;
+    for (const Orders& orders : policies)
+    {
+        std::cout << orders.name << std::endl;
+        Checker checker(orders, trace);
+        bool foundProblem = false;
+        for (const Litmus& test : tests)
+        {
+            std::string problem = checker.run(test);
+            std::cout << "    " << test.name << ": " << (problem.empty() ? "ok" : "RACE, " + problem) << std::endl;
+            foundProblem = foundProblem || !problem.empty();
+        }
+        std::cout << "    " << checker.executions << " executions, acquire on "
+                  << (checker.decrements == 0 ? 0 : 100 * checker.acquiringDecrements / checker.decrements) << "% of decrements" << std::endl;
+
+        if (foundProblem == orders.expectSafe)
+        {
+            std::cout << "    UNEXPECTED: this policy was supposed to " << (orders.expectSafe ? "pass" : "fail") << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
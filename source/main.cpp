@@ -163,6 +163,9 @@ int main()
         delete what.release();
         what = std::unique_ptr<Person>(new Person("what"));
 
+        // (A unique_ptr is just one pointer, and a pointer has a few bits it never uses.
+        //  header/tagged_ptr.h keeps small things like a generation number or a "dirty" flag for parent in those bits, for free)
+
         std::cin.get();
 
     }
@@ -212,6 +215,8 @@ int main()
         blossom->parent = std::shared_ptr<Person>(new Person("Professor"));
         bubbles->parent = blossom->parent;      // Unlike with unique_ptr, we can assign a shared_ptr to eachother.
         buttercup->parent = bubbles->parent;    // This increments the reference counter from each one that has it. (at this point it will be 3.)
+                                                // (Each of those is an atomic increment. If the Professor lived forever, header/tuned_ptr.h
+                                                //  could make him "immortal" and skip the counting altogether)
 
         std::cout << "blossom->parent.use_count(): " << blossom->parent.use_count() << std::endl;
         // Now, me deleting blossom won't delete the professor, he will only be deleted when all 3 of them are also deleted.
@@ -274,6 +279,21 @@ int main()
         {
             std::cout << "weakPtr.lock() == nullptr" << std::endl;  // The lock now gives a nullptr, meaning the object has been deleted already.
         }
+        // (We had to ask to find that out. header/expiry_notify.h lets Fredzilla tell us instead, the moment he's deleted)
+        std::cin.get();
+
+
+
+        // One more trick: a shared_ptr can point at just PART of an object, and still keep the whole object alive.
+        // This is the "aliasing constructor": the first argument is who to share the reference count with, the second is what to point at.
+        {
+            std::shared_ptr<Person> mojo = std::shared_ptr<Person>(new Person("Mojo Jojo"));
+            std::shared_ptr<std::string> name(mojo, &mojo->name);  // Shares mojo's counter, but points at his name. (use_count is now 2)
+
+            mojo.reset();                                           // Mojo isn't destructed here, name is still holding on to him.
+            std::cout << "*name: " << *name << std::endl;
+        }                                                           // name goes away, and Mojo finally goes with it.
+                                                                    // (header/shared_slice.h uses this to share pieces of arrays and strings without copying them)
     }
     std::cin.get();
 